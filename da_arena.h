@@ -0,0 +1,189 @@
+/* da_arena - v1.0 - public domain arena allocator for dynamic_array.h
+
+   A bump allocator over a caller-provided buffer, meant to be passed as the
+   `ctx' argument of the da_* macros. Allocating is a pointer bump, growing
+   the most recent allocation extends it in place, and everything is
+   released at once with da_arena_reset().
+
+   DOCUMENTATION
+     (usage: see provided example)
+
+     DaArena
+       allocator context (`ctx' argument of the da_* macros)
+
+     DA_ARENA_ALIGN
+       alignment of every allocation, defaults to 16, may be defined before
+       including this file
+
+     da_arena_init(arena, buf, size)
+       use the `size' bytes at `buf' for the arena, the buffer is owned by
+       the caller and must outlive the arena
+
+     da_arena_reset(arena)
+       release every allocation made from the arena in O(1)
+
+     da_arena_alloc(arena, sz)
+       allocate `sz' bytes, returns NULL when the arena is full
+
+     da_arena_realloc(arena, ptr, oldsz, newsz)
+       resize an allocation, in place if it is the most recent one (or if it
+       shrinks), otherwise allocate a new block and copy `oldsz' bytes to it
+
+     da_arena_try_expand(arena, ptr, oldsz, newsz)
+       grow `ptr' in place if it is the most recent allocation and the arena
+       has room, returns nonzero on success. suitable as DA_TRY_EXPAND
+
+     da_arena_free(arena, ptr, sz)
+       give the memory back if `ptr' is the most recent allocation,
+       otherwise do nothing until the arena is reset
+
+   LICENSE
+
+     Placed in the public domain and also MIT licensed.
+     See end of dynamic_array.h for detailed license information.
+
+   CREDITS
+
+     Listeria monocytogenes
+*/
+
+#ifndef DA_ARENA_H
+#define DA_ARENA_H
+
+/** Example (per-request scratch arrays) */
+#if 0
+#include <stdio.h>
+
+#include "da_arena.h"
+
+#define DA_MALLOC(ctx, sz)                    da_arena_alloc(ctx, sz)
+#define DA_REALLOC(ctx, oldptr, oldsz, newsz) da_arena_realloc(ctx, oldptr, oldsz, newsz)
+#define DA_FREE(ctx, ptr, sz)                 da_arena_free(ctx, ptr, sz)
+#include "dynamic_array.h"
+
+static char scratch[1 << 20];
+
+static void handle_request(DaArena *arena, int n)
+{
+    DynamicArray(int) ids = DA_INIT;
+    StringBuilder out = SB_INIT;
+
+    for (int i = 0; i < n; i++)
+        da_append(arena, &ids, i);
+
+    for (size_t i = 0; i < ids.count; i++)
+        sb_append_cstr(arena, &out, i % 2 ? "odd " : "even ");
+    sb_append_null(arena, &out);
+
+    fputs(out.items, stdout);
+    /* no da_free(), the arena is reset after every request */
+}
+
+int main(void)
+{
+    DaArena arena;
+
+    da_arena_init(&arena, scratch, sizeof(scratch));
+    for (int i = 0; i < 10; i++) {
+        handle_request(&arena, i);
+        da_arena_reset(&arena);
+    }
+    return 0;
+}
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef DA_ARENA_ALIGN
+# define DA_ARENA_ALIGN 16
+#endif
+
+typedef struct {
+    char *base;
+    size_t size;
+    size_t used;
+    char *last;
+} DaArena;
+
+static inline void
+da_arena_init(DaArena *arena, void *buf, size_t size)
+{
+    arena->base = (char *)buf;
+    arena->size = size;
+    arena->used = 0;
+    arena->last = NULL;
+}
+
+static inline void
+da_arena_reset(DaArena *arena)
+{
+    arena->used = 0;
+    arena->last = NULL;
+}
+
+static inline void *
+da_arena_alloc(DaArena *arena, size_t sz)
+{
+    uintptr_t top = (uintptr_t)(arena->base + arena->used);
+    size_t pad = (size_t)(-top & (DA_ARENA_ALIGN - 1));
+
+    if (pad > arena->size - arena->used ||
+        sz > arena->size - arena->used - pad)
+        return NULL;
+
+    arena->last = arena->base + arena->used + pad;
+    arena->used += pad + sz;
+    return arena->last;
+}
+
+static inline int
+da_arena_try_expand(DaArena *arena, void *ptr, size_t oldsz, size_t newsz)
+{
+    size_t offset;
+
+    (void)oldsz;
+
+    if (!ptr || (char *)ptr != arena->last)
+        return 0;
+
+    offset = (size_t)(arena->last - arena->base);
+    if (newsz > arena->size - offset)
+        return 0;
+
+    arena->used = offset + newsz;
+    return 1;
+}
+
+static inline void *
+da_arena_realloc(DaArena *arena, void *ptr, size_t oldsz, size_t newsz)
+{
+    void *p;
+
+    if (!ptr)
+        return da_arena_alloc(arena, newsz);
+
+    if ((char *)ptr == arena->last)
+        return da_arena_try_expand(arena, ptr, oldsz, newsz) ? ptr : NULL;
+
+    if (newsz <= oldsz)
+        return ptr;
+
+    p = da_arena_alloc(arena, newsz);
+    if (p)
+        memcpy(p, ptr, oldsz);
+    return p;
+}
+
+static inline void
+da_arena_free(DaArena *arena, void *ptr, size_t sz)
+{
+    (void)sz;
+
+    if (ptr && (char *)ptr == arena->last) {
+        arena->used = (size_t)(arena->last - arena->base);
+        arena->last = NULL;
+    }
+}
+
+#endif // DA_ARENA_H
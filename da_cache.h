@@ -0,0 +1,252 @@
+/* da_cache - v1.0 - public domain freed-buffer cache for dynamic_array.h
+
+   Keeps a few recently freed buffers per power-of-two size class in thread
+   local storage and hands them back to the next allocation of that class,
+   so code that builds and frees similar arrays over and over (e.g. once
+   per request) stops going to malloc after warming up.
+
+   Every cached allocation is rounded up to its size class, growing within
+   the class is free, and sizes above DA_CACHE_MAX_SIZE bypass the cache.
+   The total size of the buffers kept by a thread is capped by
+   DA_CACHE_MAX_BYTES, buffers freed past the caps go back to free(3).
+
+   Do this:
+      #define DA_CACHE_IMPLEMENTATION
+   before you include this file in *one* C or C++ file to create the
+   implementation, the configuration macros must be the same everywhere.
+
+   DOCUMENTATION
+     (usage: see provided example)
+
+     DA_CACHE_MAX_SIZE
+       largest cached size class in bytes, defaults to 1 MiB
+
+     DA_CACHE_SLOTS
+       number of buffers cached per size class, defaults to 4
+
+     DA_CACHE_MAX_BYTES
+       limit on the bytes cached by a single thread, defaults to 4 MiB
+
+     da_cache_alloc(sz)
+     da_cache_realloc(ptr, oldsz, newsz)
+     da_cache_free(ptr, sz)
+       malloc, realloc and free counterparts, `oldsz' and `sz' must be the
+       sizes the allocation was last requested with (or the size reported
+       by da_cache_usable_size())
+
+     da_cache_usable_size(sz)
+       size of the block that a request of `sz' bytes gets, suitable as
+       DA_USABLE_SIZE so that arrays use the whole size class
+
+     da_cache_flush()
+       free every buffer cached by the calling thread, must be called
+       before a thread exits or its cached buffers are leaked
+
+   LICENSE
+
+     Placed in the public domain and also MIT licensed.
+     See end of dynamic_array.h for detailed license information.
+
+   CREDITS
+
+     Listeria monocytogenes
+*/
+
+#ifndef DA_CACHE_H
+#define DA_CACHE_H
+
+/** Example (request handler) */
+#if 0
+#include <stdio.h>
+
+#define DA_CACHE_IMPLEMENTATION
+#include "da_cache.h"
+
+#define DA_MALLOC(ctx, sz)                    da_cache_alloc(sz)
+#define DA_REALLOC(ctx, oldptr, oldsz, newsz) da_cache_realloc(oldptr, oldsz, newsz)
+#define DA_FREE(ctx, ptr, sz)                 da_cache_free(ptr, sz)
+#define DA_USABLE_SIZE(ctx, ptr, sz)          da_cache_usable_size(sz)
+#include "dynamic_array.h"
+
+static void handle_request(int n)
+{
+    DynamicArray(int) ids = DA_INIT;
+    StringBuilder out = SB_INIT;
+
+    /* after the first request these come from the cache */
+    for (int i = 0; i < n; i++)
+        da_append(, &ids, i);
+    for (size_t i = 0; i < ids.count; i++)
+        sb_append_cstr(, &out, i % 2 ? "odd " : "even ");
+    sb_append_null(, &out);
+
+    puts(out.items);
+    da_free(, &ids);
+    sb_free(, &out);
+}
+
+int main(void)
+{
+    for (int i = 0; i < 1000; i++)
+        handle_request(i % 100);
+    da_cache_flush();
+    return 0;
+}
+#endif
+
+#include <stddef.h>
+
+#ifndef DA_CACHE_MAX_SIZE
+# define DA_CACHE_MAX_SIZE ((size_t)1 << 20)
+#endif
+
+#ifndef DA_CACHE_SLOTS
+# define DA_CACHE_SLOTS 4
+#endif
+
+#ifndef DA_CACHE_MAX_BYTES
+# define DA_CACHE_MAX_BYTES ((size_t)4 << 20)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *da_cache_alloc(size_t sz);
+void *da_cache_realloc(void *ptr, size_t oldsz, size_t newsz);
+void da_cache_free(void *ptr, size_t sz);
+void da_cache_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* smallest size class */
+#define DA_CACHE__MIN_SHIFT 4
+
+/* size class of a cached allocation of `sz' bytes (for private use) */
+static inline unsigned
+da_cache__class(size_t sz)
+{
+    unsigned c = DA_CACHE__MIN_SHIFT;
+
+    while (((size_t)1 << c) < sz)
+        c++;
+    return c;
+}
+
+static inline size_t
+da_cache_usable_size(size_t sz)
+{
+    if (sz == 0 || sz > DA_CACHE_MAX_SIZE)
+        return sz;
+    return (size_t)1 << da_cache__class(sz);
+}
+
+#endif // DA_CACHE_H
+
+#ifdef DA_CACHE_IMPLEMENTATION
+#ifndef DA_CACHE_IMPLEMENTATION_DONE
+#define DA_CACHE_IMPLEMENTATION_DONE
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__cplusplus)
+# define DA_CACHE__TLS thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+# define DA_CACHE__TLS _Thread_local
+#elif defined(_MSC_VER)
+# define DA_CACHE__TLS __declspec(thread)
+#else
+# define DA_CACHE__TLS __thread
+#endif
+
+#define DA_CACHE__CLASSES (sizeof(size_t) * 8)
+
+typedef struct {
+    void *slots[DA_CACHE__CLASSES][DA_CACHE_SLOTS];
+    unsigned count[DA_CACHE__CLASSES];
+    size_t bytes;
+} DaCache__Magazine;
+
+static DA_CACHE__TLS DaCache__Magazine da_cache__tls;
+
+#define DA_CACHE__CACHED(sz) ((sz) > 0 && (sz) <= DA_CACHE_MAX_SIZE)
+
+void *
+da_cache_alloc(size_t sz)
+{
+    DaCache__Magazine *m = &da_cache__tls;
+    unsigned c;
+
+    if (!DA_CACHE__CACHED(sz))
+        return malloc(sz);
+
+    c = da_cache__class(sz);
+    if (m->count[c] > 0) {
+        m->bytes -= (size_t)1 << c;
+        return m->slots[c][--m->count[c]];
+    }
+    return malloc((size_t)1 << c);
+}
+
+void
+da_cache_free(void *ptr, size_t sz)
+{
+    DaCache__Magazine *m = &da_cache__tls;
+    unsigned c;
+
+    if (!ptr)
+        return;
+
+    if (DA_CACHE__CACHED(sz)) {
+        c = da_cache__class(sz);
+        if (m->count[c] < DA_CACHE_SLOTS &&
+            ((size_t)1 << c) <= DA_CACHE_MAX_BYTES - m->bytes) {
+            m->slots[c][m->count[c]++] = ptr;
+            m->bytes += (size_t)1 << c;
+            return;
+        }
+    }
+    free(ptr);
+}
+
+void *
+da_cache_realloc(void *ptr, size_t oldsz, size_t newsz)
+{
+    void *p;
+
+    if (!ptr)
+        return da_cache_alloc(newsz);
+
+    if (!DA_CACHE__CACHED(oldsz) && !DA_CACHE__CACHED(newsz))
+        return realloc(ptr, newsz);
+
+    /* same size class, the block is already big enough */
+    if (DA_CACHE__CACHED(oldsz) && DA_CACHE__CACHED(newsz) &&
+        da_cache__class(oldsz) == da_cache__class(newsz))
+        return ptr;
+
+    p = da_cache_alloc(newsz);
+    if (p) {
+        memcpy(p, ptr, oldsz < newsz ? oldsz : newsz);
+        da_cache_free(ptr, oldsz);
+    }
+    return p;
+}
+
+void
+da_cache_flush(void)
+{
+    DaCache__Magazine *m = &da_cache__tls;
+    size_t c;
+
+    for (c = 0; c < DA_CACHE__CLASSES; c++)
+        while (m->count[c] > 0)
+            free(m->slots[c][--m->count[c]]);
+    m->bytes = 0;
+}
+
+#endif // DA_CACHE_IMPLEMENTATION_DONE
+#endif // DA_CACHE_IMPLEMENTATION
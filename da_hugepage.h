@@ -0,0 +1,251 @@
+/* da_hugepage - v1.0 - public domain transparent huge page backend for
+   dynamic_array.h
+
+   Small allocations go through malloc, realloc and free. Allocations of at
+   least DA_HUGEPAGE_THRESHOLD bytes are given their own anonymous mapping,
+   aligned to DA_HUGEPAGE_SIZE and advised with madvise(MADV_HUGEPAGE) so
+   that the kernel backs them with transparent huge pages, which cuts the
+   TLB misses of random accesses into large arrays.
+
+   Growing a mapped allocation moves its pages to a new aligned range with
+   mremap(2), nothing is copied. Shrinking it (da_shrink_to_fit) unmaps the
+   tail in place, and da_hugepage_trim() hands the unused tail of an array
+   back to the kernel without changing its capacity, e.g. after popping
+   most of its items.
+
+   The kind of an allocation is told apart by its size alone, which is why
+   it relies on the `oldsz' and `sz' arguments that dynamic_array.h passes to
+   DA_REALLOC and DA_FREE.
+
+   Linux only, needs mremap(2) and MADV_HUGEPAGE (compile with _GNU_SOURCE).
+
+   DOCUMENTATION
+     (usage: see provided example)
+
+     DA_HUGEPAGE_THRESHOLD
+       size in bytes from which allocations are mapped, defaults to 32 MiB,
+       may be defined before including this file
+
+     DA_HUGEPAGE_SIZE
+       huge page size the mappings are aligned to, defaults to 2 MiB
+
+     DA_HUGEPAGE_TRIM_ADVICE
+       advice used by da_hugepage_trim(), defaults to MADV_DONTNEED, may be
+       defined to MADV_FREE to let the kernel reclaim the pages lazily
+
+     da_hugepage_alloc(sz)
+     da_hugepage_realloc(ptr, oldsz, newsz)
+     da_hugepage_free(ptr, sz)
+       malloc, realloc and free counterparts, `oldsz' and `sz' must be the
+       sizes the allocation was last requested with
+
+     da_hugepage_trim(ptr, used, sz)
+       release the whole huge pages past the first `used' bytes of the
+       allocation of `sz' bytes at `ptr', they read back as zeroes (or as
+       their old contents with MADV_FREE) and are faulted in again on the
+       next write. does nothing for allocations that aren't mapped
+
+   LICENSE
+
+     Placed in the public domain and also MIT licensed.
+     See end of dynamic_array.h for detailed license information.
+
+   CREDITS
+
+     Listeria monocytogenes
+*/
+
+#ifndef DA_HUGEPAGE_H
+#define DA_HUGEPAGE_H
+
+/** Example (random-access lookups) */
+#if 0
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "da_hugepage.h"
+
+/* build once with and once without USE_HUGEPAGE to compare */
+#ifdef USE_HUGEPAGE
+#define DA_MALLOC(ctx, sz)                    da_hugepage_alloc(sz)
+#define DA_REALLOC(ctx, oldptr, oldsz, newsz) da_hugepage_realloc(oldptr, oldsz, newsz)
+#define DA_FREE(ctx, ptr, sz)                 da_hugepage_free(ptr, sz)
+#endif
+#include "dynamic_array.h"
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+    DynamicArray(unsigned long) table = DA_INIT;
+    unsigned long x = 88172645463325252UL, sum = 0;
+    double start;
+
+    /* 4 GiB lookup table */
+    for (unsigned long i = 0; i < (1UL << 29); i++)
+        da_append(, &table, i * 2654435761UL);
+
+    start = now();
+    for (int i = 0; i < 100000000; i++) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        sum += table.items[x % table.count];
+    }
+    printf("%.2f ns per lookup (%lu)\n", (now() - start) * 10, sum);
+
+#ifdef USE_HUGEPAGE
+    /* keep the capacity but give back what the popped items used */
+    table.count /= 8;
+    da_hugepage_trim(table.items, table.count * sizeof(*table.items),
+                     table.capacity * sizeof(*table.items));
+#endif
+
+    da_free(, &table);
+    return 0;
+}
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef DA_HUGEPAGE_THRESHOLD
+# define DA_HUGEPAGE_THRESHOLD ((size_t)32 << 20)
+#endif
+
+#ifndef DA_HUGEPAGE_SIZE
+# define DA_HUGEPAGE_SIZE ((size_t)2 << 20)
+#endif
+
+#ifndef DA_HUGEPAGE_TRIM_ADVICE
+# define DA_HUGEPAGE_TRIM_ADVICE MADV_DONTNEED
+#endif
+
+#define DA_HUGEPAGE__MAPPED(sz) ((sz) >= DA_HUGEPAGE_THRESHOLD)
+
+static inline size_t
+da_hugepage__round(size_t sz)
+{
+    return (sz + DA_HUGEPAGE_SIZE - 1) / DA_HUGEPAGE_SIZE * DA_HUGEPAGE_SIZE;
+}
+
+/* reserve `len' bytes of address space aligned to DA_HUGEPAGE_SIZE
+   (for private use) */
+static inline char *
+da_hugepage__reserve(size_t len)
+{
+    char *p, *aligned;
+    size_t head;
+
+    if (len > (size_t)-1 - DA_HUGEPAGE_SIZE)
+        return NULL;
+
+    p = (char *)mmap(NULL, len + DA_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    aligned = (char *)da_hugepage__round((size_t)p);
+    head = (size_t)(aligned - p);
+    if (head > 0)
+        munmap(p, head);
+    munmap(aligned + len, DA_HUGEPAGE_SIZE - head);
+    return aligned;
+}
+
+static inline void *
+da_hugepage_alloc(size_t sz)
+{
+    size_t len;
+    char *p;
+
+    if (!DA_HUGEPAGE__MAPPED(sz))
+        return malloc(sz);
+
+    len = da_hugepage__round(sz);
+    if (len < sz || !(p = da_hugepage__reserve(len)))
+        return NULL;
+
+    madvise(p, len, MADV_HUGEPAGE);
+    return p;
+}
+
+static inline void
+da_hugepage_free(void *ptr, size_t sz)
+{
+    if (!DA_HUGEPAGE__MAPPED(sz))
+        free(ptr);
+    else if (ptr)
+        munmap(ptr, da_hugepage__round(sz));
+}
+
+static inline void *
+da_hugepage_realloc(void *ptr, size_t oldsz, size_t newsz)
+{
+    size_t oldlen, newlen;
+    char *p;
+
+    if (!ptr)
+        return da_hugepage_alloc(newsz);
+
+    if (!DA_HUGEPAGE__MAPPED(oldsz) && !DA_HUGEPAGE__MAPPED(newsz))
+        return realloc(ptr, newsz);
+
+    if (DA_HUGEPAGE__MAPPED(oldsz) && DA_HUGEPAGE__MAPPED(newsz)) {
+        oldlen = da_hugepage__round(oldsz);
+        newlen = da_hugepage__round(newsz);
+        if (newlen < newsz)
+            return NULL;
+
+        /* shrinking, or growing into the free space right after it */
+        p = (char *)mremap(ptr, oldlen, newlen, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, newlen, MADV_HUGEPAGE);
+            return p;
+        }
+
+        /* move the pages to a new aligned range, the reservation is
+           replaced by the moved mapping */
+        if (!(p = da_hugepage__reserve(newlen)))
+            return NULL;
+        if (mremap(ptr, oldlen, newlen, MREMAP_MAYMOVE | MREMAP_FIXED, p)
+            == MAP_FAILED) {
+            munmap(p, newlen);
+            return NULL;
+        }
+        madvise(p, newlen, MADV_HUGEPAGE);
+        return p;
+    }
+
+    /* crossing the threshold, copy once between malloc and a mapping */
+    p = (char *)da_hugepage_alloc(newsz);
+    if (p) {
+        memcpy(p, ptr, oldsz < newsz ? oldsz : newsz);
+        da_hugepage_free(ptr, oldsz);
+    }
+    return p;
+}
+
+static inline void
+da_hugepage_trim(void *ptr, size_t used, size_t sz)
+{
+    size_t keep, len;
+
+    if (!ptr || !DA_HUGEPAGE__MAPPED(sz))
+        return;
+
+    keep = da_hugepage__round(used);
+    len = da_hugepage__round(sz);
+    if (keep < len)
+        madvise((char *)ptr + keep, len - keep, DA_HUGEPAGE_TRIM_ADVICE);
+}
+
+#endif // DA_HUGEPAGE_H
@@ -0,0 +1,130 @@
+/* da_mremap - v1.0 - public domain mremap backend for dynamic_array.h
+
+   Small allocations go through malloc, realloc and free. Allocations of at
+   least DA_MREMAP_THRESHOLD bytes are given their own anonymous mapping and
+   grown with mremap(MREMAP_MAYMOVE), which moves page table entries instead
+   of copying bytes.
+
+   The kind of an allocation is told apart by its size alone, which is why
+   it relies on the `oldsz' and `sz' arguments that dynamic_array.h passes to
+   DA_REALLOC and DA_FREE.
+
+   Linux only, needs mremap(2) (compile with _GNU_SOURCE).
+
+   DOCUMENTATION
+     (usage: see provided example)
+
+     DA_MREMAP_THRESHOLD
+       size in bytes from which allocations are mapped, defaults to 1 MiB,
+       may be defined before including this file
+
+     da_mremap_alloc(sz)
+     da_mremap_realloc(ptr, oldsz, newsz)
+     da_mremap_free(ptr, sz)
+       malloc, realloc and free counterparts, `oldsz' and `sz' must be the
+       sizes the allocation was last requested with
+
+   LICENSE
+
+     Placed in the public domain and also MIT licensed.
+     See end of dynamic_array.h for detailed license information.
+
+   CREDITS
+
+     Listeria monocytogenes
+*/
+
+#ifndef DA_MREMAP_H
+#define DA_MREMAP_H
+
+/** Example (usage) */
+#if 0
+#define _GNU_SOURCE
+#include "da_mremap.h"
+
+#define DA_MALLOC(ctx, sz)                    da_mremap_alloc(sz)
+#define DA_REALLOC(ctx, oldptr, oldsz, newsz) da_mremap_realloc(oldptr, oldsz, newsz)
+#define DA_FREE(ctx, ptr, sz)                 da_mremap_free(ptr, sz)
+#include "dynamic_array.h"
+
+int main(void)
+{
+    DynamicArray(double) da = DA_INIT;
+
+    /* past 1 MiB every doubling is an mremap(2) instead of a copy */
+    for (int i = 0; i < 100000000; i++)
+        da_append(, &da, i);
+
+    da_free(, &da);
+    return 0;
+}
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef DA_MREMAP_THRESHOLD
+# define DA_MREMAP_THRESHOLD ((size_t)1 << 20)
+#endif
+
+#define DA_MREMAP__MAPPED(sz) ((sz) >= DA_MREMAP_THRESHOLD)
+
+static inline size_t
+da_mremap__round(size_t sz)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    return (sz + page - 1) / page * page;
+}
+
+static inline void *
+da_mremap_alloc(size_t sz)
+{
+    void *p;
+
+    if (!DA_MREMAP__MAPPED(sz))
+        return malloc(sz);
+
+    p = mmap(NULL, da_mremap__round(sz), PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static inline void
+da_mremap_free(void *ptr, size_t sz)
+{
+    if (!DA_MREMAP__MAPPED(sz))
+        free(ptr);
+    else if (ptr)
+        munmap(ptr, da_mremap__round(sz));
+}
+
+static inline void *
+da_mremap_realloc(void *ptr, size_t oldsz, size_t newsz)
+{
+    void *p;
+
+    if (!ptr)
+        return da_mremap_alloc(newsz);
+
+    if (!DA_MREMAP__MAPPED(oldsz) && !DA_MREMAP__MAPPED(newsz))
+        return realloc(ptr, newsz);
+
+    if (DA_MREMAP__MAPPED(oldsz) && DA_MREMAP__MAPPED(newsz)) {
+        p = mremap(ptr, da_mremap__round(oldsz), da_mremap__round(newsz),
+                   MREMAP_MAYMOVE);
+        return p == MAP_FAILED ? NULL : p;
+    }
+
+    /* crossing the threshold, copy once between malloc and a mapping */
+    p = da_mremap_alloc(newsz);
+    if (p) {
+        memcpy(p, ptr, oldsz < newsz ? oldsz : newsz);
+        da_mremap_free(ptr, oldsz);
+    }
+    return p;
+}
+
+#endif // DA_MREMAP_H
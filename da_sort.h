@@ -0,0 +1,887 @@
+/* da_sort - v1.0 - public domain typed sorting for dynamic_array.h
+
+   Generates sorting functions specialized for an item type and a
+   comparison, so that every comparison is inlined instead of being an
+   indirect call through qsort(3)'s function pointer.
+
+   The unstable sort is a pattern-defeating quicksort: an introsort with
+   median-of-3 (ninther for large ranges) pivots, insertion sort for small
+   ranges, a fast path for already partitioned ranges, linear time on runs
+   of equal items and a heapsort fallback that bounds the worst case to
+   O(n log n). The stable sort is a merge sort with a scratch buffer of
+   n / 2 items allocated through DA_MALLOC.
+
+   The radix sort is a stable LSD radix sort on an unsigned integer key
+   extracted from every item, with 8-bit digits, or 11-bit digits (6 passes
+   instead of 8) for large arrays with 64-bit keys. A single read computes
+   the counts of every digit, and the passes whose digit is the same for
+   every item are skipped, e.g. the high bytes of small integers.
+
+   The parallel sort (opt-in, needs POSIX threads) splits the items in one
+   chunk per thread, sorts the chunks with name_sort() and merges them with
+   a parallel multiway merge: every thread finds where its share of the
+   output starts in each sorted chunk by binary search and merges those
+   ranges into place with a heap, so the merge is split evenly however the
+   items are distributed.
+
+   DOCUMENTATION
+     (usage: see provided example)
+
+     DA_DEFINE_SORT(name, T, less);
+       define the following static inline functions, `less(a, b)' is
+       evaluated with two lvalues of type T and must be nonzero if `a'
+       sorts before `b' (a macro or a function):
+
+       void name_sort(T *items, size_t count)
+         sort `count' items in place, not stable
+
+       int name_stable_sort(T *items, size_t count) - uses DA_MALLOC
+         sort `count' items in place keeping the order of equal items,
+         returns zero and leaves the items untouched if the scratch buffer
+         can't be allocated
+
+       e.g. name_sort(da.items, da.count)
+
+     DA_DEFINE_SORT_CTX(name, T, less, CtxT);
+       same as DA_DEFINE_SORT() but name_stable_sort() takes a `CtxT ctx'
+       first argument that is passed to DA_MALLOC and DA_FREE
+
+     DA_DEFINE_RADIX_SORT(name, T, K, key);
+       define the following static inline function, `key(x)' is evaluated
+       with an lvalue of type T and returns its key of unsigned integer type
+       K, items are sorted by increasing key:
+
+       int name_radix_sort(T *items, size_t count) - uses DA_MALLOC
+         sort `count' items in place keeping the order of equal keys,
+         returns zero and leaves the items untouched if the scratch buffer
+         (`count' items and the digit counts) can't be allocated
+
+     DA_DEFINE_RADIX_SORT_CTX(name, T, K, key, CtxT);
+       same as DA_DEFINE_RADIX_SORT() but name_radix_sort() takes a
+       `CtxT ctx' first argument that is passed to DA_MALLOC and DA_FREE
+
+     DA_RADIX_WIDE
+       item count from which 11-bit digits are used for keys wider than 32
+       bits, defaults to 65536, may be defined before including this file
+
+     DA_SORT_PTHREADS
+       define before including this file to get the parallel sort, link
+       with -pthread
+
+     DA_DEFINE_PARALLEL_SORT(name, T, less);
+       define the following static inline function, requires the functions
+       of DA_DEFINE_SORT(name, T, less):
+
+       int name_parallel_sort(T *items, size_t count, unsigned threads)
+         - uses DA_MALLOC
+         sort `count' items in place using up to `threads' threads
+         (including the calling one), not stable. returns zero and leaves
+         the items untouched if the merge buffer (`count' items) can't be
+         allocated, runs the work of the threads that can't be created in
+         the calling thread
+
+     DA_DEFINE_PARALLEL_SORT_CTX(name, T, less, CtxT);
+       same as DA_DEFINE_PARALLEL_SORT() but name_parallel_sort() takes a
+       `CtxT ctx' first argument that is passed to DA_MALLOC and DA_FREE
+
+     DA_SORT_MAX_THREADS
+       most threads used by a parallel sort, defaults to 64
+
+     DA_SORT_PARALLEL_MIN
+       fewest items sorted by each thread of a parallel sort, defaults to
+       65536, smaller arrays use fewer threads
+
+     da_radix_key_u32(x), da_radix_key_u64(x)
+     da_radix_key_i32(x), da_radix_key_i64(x)
+     da_radix_key_f32(x), da_radix_key_f64(x)
+       unsigned keys that sort like the given uint32_t, uint64_t, int32_t,
+       int64_t, float and double values, -0.0 sorts before 0.0 and NaNs sort
+       after infinity (or before -infinity if their sign bit is set)
+
+   LICENSE
+
+     Placed in the public domain and also MIT licensed.
+     See end of dynamic_array.h for detailed license information.
+
+   CREDITS
+
+     Listeria monocytogenes
+*/
+
+#ifndef DA_SORT_H
+#define DA_SORT_H
+
+/** Example (comparison against qsort) */
+#if 0
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "da_sort.h"
+
+#define int_less(a, b) ((a) < (b))
+DA_DEFINE_SORT(ints, int, int_less);
+
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+    DynamicArray(int) a = DA_INIT, b = DA_INIT;
+    double start;
+
+    for (int i = 0; i < 50000000; i++) {
+        da_append(, &a, rand());
+        da_append(, &b, a.items[i]);
+    }
+
+    start = now();
+    qsort(a.items, a.count, sizeof(*a.items), cmp_int);
+    printf("qsort:     %.2fs\n", now() - start);
+
+    start = now();
+    ints_sort(b.items, b.count);
+    printf("ints_sort: %.2fs\n", now() - start);
+
+    da_free(, &a);
+    da_free(, &b);
+    return 0;
+}
+#endif
+
+/** Example (radix sort) */
+#if 0
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "da_sort.h"
+
+typedef struct {
+    double score;
+    const char *name;
+} Entry;
+
+#define entry_key(e) da_radix_key_f64((e).score)
+DA_DEFINE_RADIX_SORT(entries, Entry, uint64_t, entry_key);
+
+#define id_key(x) (x)
+DA_DEFINE_RADIX_SORT(ids, uint32_t, uint32_t, id_key);
+
+int main(void)
+{
+    DynamicArray(Entry) entries = DA_INIT;
+    DynamicArray(uint32_t) ids = DA_INIT;
+
+    for (int i = 0; i < 10; i++) {
+        Entry e = {rand() / (double)RAND_MAX - 0.5, "entry"};
+        da_append(, &entries, e);
+        /* only the two low bytes differ, the other passes are skipped */
+        da_append(, &ids, (uint32_t)(rand() & 0xffff));
+    }
+
+    if (!entries_radix_sort(entries.items, entries.count) ||
+        !ids_radix_sort(ids.items, ids.count))
+        return 1;
+
+    for (size_t i = 0; i < entries.count; i++)
+        printf("%s %f, id %u\n", entries.items[i].name,
+               entries.items[i].score, (unsigned)ids.items[i]);
+
+    da_free(, &entries);
+    da_free(, &ids);
+    return 0;
+}
+#endif
+
+/** Example (parallel sort scaling) */
+#if 0
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DA_SORT_PTHREADS
+#include "da_sort.h"
+
+#define u64_less(a, b) ((a) < (b))
+DA_DEFINE_SORT(u64s, unsigned long long, u64_less);
+DA_DEFINE_PARALLEL_SORT(u64s, unsigned long long, u64_less);
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+    DynamicArray(unsigned long long) a = DA_INIT;
+    unsigned long long x = 88172645463325252ULL;
+    unsigned cpus = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+    double base = 0;
+
+    da_reserve(, &a, 100000000);
+    for (unsigned threads = 1; threads <= cpus; threads *= 2) {
+        double start, t;
+
+        a.count = 0;
+        for (int i = 0; i < 100000000; i++) {
+            x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+            da_append(, &a, x);
+        }
+
+        start = now();
+        if (!u64s_parallel_sort(a.items, a.count, threads))
+            return 1;
+        t = now() - start;
+        if (threads == 1)
+            base = t;
+        printf("%2u threads: %.2fs (x%.1f)\n", threads, t, base / t);
+    }
+
+    da_free(, &a);
+    return 0;
+}
+#endif
+
+#include "dynamic_array.h"
+
+#ifndef DA_RADIX_WIDE
+# define DA_RADIX_WIDE 65536
+#endif
+
+/* ranges of at most this many items are insertion sorted */
+#define DA_SORT__INSERTION 24
+
+/* ranges of more than this many items use the ninther as pivot */
+#define DA_SORT__NINTHER 128
+
+#define DA_SORT__SWAP(T, a, b)                                                \
+    do {                                                                      \
+        T da__tmp = (a);                                                      \
+        (a) = (b);                                                            \
+        (b) = da__tmp;                                                        \
+    } while (0)
+
+#define DA_DEFINE_SORT(name, T, less)                                         \
+    DA__DEFINE_SORT(name, T, less, void, DA__NO_CTX_PARAM, DA__NO_CTX)
+
+#define DA_DEFINE_SORT_CTX(name, T, less, CtxT)                               \
+    DA__DEFINE_SORT(name, T, less, CtxT, DA__CTX_PARAM, DA__CTX)
+
+#define DA__DEFINE_SORT(name, T, less, CtxT, PARAM, CTX)                      \
+    static inline void                                                        \
+    name##__insertion_sort(T *a, size_t n)                                    \
+    {                                                                         \
+        size_t i, j;                                                          \
+                                                                              \
+        for (i = 1; i < n; i++) {                                             \
+            if (!(less(a[i], a[i - 1])))                                      \
+                continue;                                                     \
+            {                                                                 \
+                T tmp = a[i];                                                 \
+                for (j = i; j > 0 && (less(tmp, a[j - 1])); j--)              \
+                    a[j] = a[j - 1];                                          \
+                a[j] = tmp;                                                   \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    /* insertion sort that gives up after moving 8 items, returns whether  */ \
+    /* it sorted the range                                                 */ \
+    static inline int                                                         \
+    name##__partial_insertion_sort(T *a, size_t n)                            \
+    {                                                                         \
+        size_t i, j, moved = 0;                                               \
+                                                                              \
+        for (i = 1; i < n; i++) {                                             \
+            if (!(less(a[i], a[i - 1])))                                      \
+                continue;                                                     \
+            {                                                                 \
+                T tmp = a[i];                                                 \
+                for (j = i; j > 0 && (less(tmp, a[j - 1])); j--)              \
+                    a[j] = a[j - 1];                                          \
+                a[j] = tmp;                                                   \
+                moved += i - j;                                               \
+            }                                                                 \
+            if (moved > 8)                                                    \
+                return 0;                                                     \
+        }                                                                     \
+        return 1;                                                             \
+    }                                                                         \
+                                                                              \
+    static inline void                                                        \
+    name##__sift_down(T *a, size_t i, size_t n)                               \
+    {                                                                         \
+        T tmp = a[i];                                                         \
+        size_t child;                                                         \
+                                                                              \
+        while ((child = 2 * i + 1) < n) {                                     \
+            if (child + 1 < n && (less(a[child], a[child + 1])))              \
+                child++;                                                      \
+            if (!(less(tmp, a[child])))                                       \
+                break;                                                        \
+            a[i] = a[child];                                                  \
+            i = child;                                                        \
+        }                                                                     \
+        a[i] = tmp;                                                           \
+    }                                                                         \
+                                                                              \
+    static inline void                                                        \
+    name##__heap_sort(T *a, size_t n)                                         \
+    {                                                                         \
+        size_t i;                                                             \
+                                                                              \
+        for (i = n / 2; i > 0; i--)                                           \
+            name##__sift_down(a, i - 1, n);                                   \
+        for (i = n; i > 1; i--) {                                             \
+            DA_SORT__SWAP(T, a[0], a[i - 1]);                                 \
+            name##__sift_down(a, 0, i - 1);                                   \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    static inline void                                                        \
+    name##__sort3(T *a, size_t i, size_t j, size_t k)                         \
+    {                                                                         \
+        if (less(a[j], a[i]))                                                 \
+            DA_SORT__SWAP(T, a[i], a[j]);                                     \
+        if (less(a[k], a[j])) {                                               \
+            DA_SORT__SWAP(T, a[j], a[k]);                                     \
+            if (less(a[j], a[i]))                                             \
+                DA_SORT__SWAP(T, a[i], a[j]);                                 \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    /* move the items less than the pivot a[0] before it and the others    */ \
+    /* after it, returns its new index                                     */ \
+    static inline size_t                                                      \
+    name##__partition_right(T *a, size_t n, int *already_partitioned)         \
+    {                                                                         \
+        T pivot = a[0];                                                       \
+        size_t i = 1, j = n - 1;                                              \
+                                                                              \
+        while (i <= j && (less(a[i], pivot)))                                 \
+            i++;                                                              \
+        while (i <= j && !(less(a[j], pivot)))                                \
+            j--;                                                              \
+        *already_partitioned = i > j;                                         \
+        while (i < j) {                                                       \
+            DA_SORT__SWAP(T, a[i], a[j]);                                     \
+            while (less(a[++i], pivot))                                       \
+                ;                                                             \
+            while (!(less(a[--j], pivot)))                                    \
+                ;                                                             \
+        }                                                                     \
+        a[0] = a[i - 1];                                                      \
+        a[i - 1] = pivot;                                                     \
+        return i - 1;                                                         \
+    }                                                                         \
+                                                                              \
+    /* same as name##__partition_right() with the items equal to the pivot */ \
+    /* before it, used when they are known to be the smallest ones         */ \
+    static inline size_t                                                      \
+    name##__partition_left(T *a, size_t n)                                    \
+    {                                                                         \
+        T pivot = a[0];                                                       \
+        size_t i = 1, j = n - 1;                                              \
+                                                                              \
+        while (i <= j && !(less(pivot, a[i])))                                \
+            i++;                                                              \
+        while (i <= j && (less(pivot, a[j])))                                 \
+            j--;                                                              \
+        while (i < j) {                                                       \
+            DA_SORT__SWAP(T, a[i], a[j]);                                     \
+            while (!(less(pivot, a[++i])))                                    \
+                ;                                                             \
+            while (less(pivot, a[--j]))                                       \
+                ;                                                             \
+        }                                                                     \
+        a[0] = a[i - 1];                                                      \
+        a[i - 1] = pivot;                                                     \
+        return i - 1;                                                         \
+    }                                                                         \
+                                                                              \
+    /* `pred' is the item right before the range (not larger than any of   */ \
+    /* its items) or NULL                                                  */ \
+    static inline void                                                        \
+    name##__pdqsort(T *a, size_t n, const T *pred, int depth)                 \
+    {                                                                         \
+        while (n > DA_SORT__INSERTION) {                                      \
+            size_t mid = n / 2, pos, l, r;                                    \
+            int already_partitioned;                                          \
+                                                                              \
+            if (n > DA_SORT__NINTHER) {                                       \
+                name##__sort3(a, 0, mid, n - 1);                              \
+                name##__sort3(a, 1, mid - 1, n - 2);                          \
+                name##__sort3(a, 2, mid + 1, n - 3);                          \
+                name##__sort3(a, mid - 1, mid, mid + 1);                      \
+            } else {                                                          \
+                name##__sort3(a, 0, mid, n - 1);                              \
+            }                                                                 \
+            DA_SORT__SWAP(T, a[0], a[mid]);                                   \
+                                                                              \
+            /* the pivot equals `pred', skip the run of items equal to it */  \
+            if (pred && !(less(*pred, a[0]))) {                               \
+                pos = name##__partition_left(a, n);                           \
+                pred = &a[pos];                                               \
+                a += pos + 1;                                                 \
+                n -= pos + 1;                                                 \
+                continue;                                                     \
+            }                                                                 \
+                                                                              \
+            pos = name##__partition_right(a, n, &already_partitioned);        \
+            l = pos;                                                          \
+            r = n - pos - 1;                                                  \
+                                                                              \
+            if (l < n / 8 || r < n / 8) {                                     \
+                /* unbalanced, shuffle some items around to break the     */  \
+                /* pattern and fall back to heapsort if it keeps going    */  \
+                if (--depth == 0) {                                           \
+                    name##__heap_sort(a, n);                                  \
+                    return;                                                   \
+                }                                                             \
+                if (l > DA_SORT__INSERTION) {                                 \
+                    DA_SORT__SWAP(T, a[0], a[l / 4]);                         \
+                    DA_SORT__SWAP(T, a[l - 1], a[l - l / 4]);                 \
+                }                                                             \
+                if (r > DA_SORT__INSERTION) {                                 \
+                    DA_SORT__SWAP(T, a[pos + 1], a[pos + 1 + r / 4]);         \
+                    DA_SORT__SWAP(T, a[n - 1], a[n - r / 4]);                 \
+                }                                                             \
+            } else if (already_partitioned &&                                 \
+                       name##__partial_insertion_sort(a, l) &&                \
+                       name##__partial_insertion_sort(a + pos + 1, r)) {      \
+                return;                                                       \
+            }                                                                 \
+                                                                              \
+            /* recurse into the smaller side, loop on the larger one */       \
+            if (l < r) {                                                      \
+                name##__pdqsort(a, l, pred, depth);                           \
+                pred = &a[pos];                                               \
+                a += pos + 1;                                                 \
+                n = r;                                                        \
+            } else {                                                          \
+                name##__pdqsort(a + pos + 1, r, &a[pos], depth);              \
+                n = l;                                                        \
+            }                                                                 \
+        }                                                                     \
+        name##__insertion_sort(a, n);                                         \
+    }                                                                         \
+                                                                              \
+    static inline void                                                        \
+    name##_sort(T *items, size_t count)                                       \
+    {                                                                         \
+        int depth = 1;                                                        \
+        size_t n;                                                             \
+                                                                              \
+        for (n = count; n > 1; n >>= 1)                                       \
+            depth++;                                                          \
+        name##__pdqsort(items, count, NULL, depth);                           \
+    }                                                                         \
+                                                                              \
+    /* merge sort of `a' using `buf' (at least n / 2 items) */                \
+    static inline void                                                        \
+    name##__merge_sort(T *a, size_t n, T *buf)                                \
+    {                                                                         \
+        size_t mid = n / 2, i = 0, j = mid, k = 0;                            \
+                                                                              \
+        if (n <= DA_SORT__INSERTION) {                                        \
+            name##__insertion_sort(a, n);                                     \
+            return;                                                           \
+        }                                                                     \
+        name##__merge_sort(a, mid, buf);                                      \
+        name##__merge_sort(a + mid, n - mid, buf);                            \
+        if (!(less(a[mid], a[mid - 1])))                                      \
+            return;                                                           \
+                                                                              \
+        /* merge the left half, moved to `buf', with the right half */        \
+        DA_MEMCPY(buf, a, sizeof(T) * mid);                                   \
+        while (i < mid && j < n)                                              \
+            a[k++] = (less(a[j], buf[i])) ? a[j++] : buf[i++];                \
+        while (i < mid)                                                       \
+            a[k++] = buf[i++];                                                \
+    }                                                                         \
+                                                                              \
+    static inline int                                                         \
+    name##_stable_sort(PARAM(CtxT) T *items, size_t count)                    \
+    {                                                                         \
+        T *buf;                                                               \
+                                                                              \
+        if (count <= DA_SORT__INSERTION) {                                    \
+            name##__insertion_sort(items, count);                             \
+            return 1;                                                         \
+        }                                                                     \
+        buf = (T *)DA_MALLOC(CTX(ctx), sizeof(T) * (count / 2));              \
+        if (!buf)                                                             \
+            return 0;                                                         \
+        name##__merge_sort(items, count, buf);                                \
+        DA_FREE(CTX(ctx), buf, sizeof(T) * (count / 2));                      \
+        return 1;                                                             \
+    }                                                                         \
+                                                                              \
+    typedef int name##__define_sort_requires_a_semicolon
+
+static inline uint32_t
+da_radix_key_u32(uint32_t x)
+{
+    return x;
+}
+
+static inline uint64_t
+da_radix_key_u64(uint64_t x)
+{
+    return x;
+}
+
+static inline uint32_t
+da_radix_key_i32(int32_t x)
+{
+    return (uint32_t)x ^ ((uint32_t)1 << 31);
+}
+
+static inline uint64_t
+da_radix_key_i64(int64_t x)
+{
+    return (uint64_t)x ^ ((uint64_t)1 << 63);
+}
+
+/* flip every bit of negative numbers and the sign bit of the others */
+static inline uint32_t
+da_radix_key_f32(float x)
+{
+    uint32_t u;
+
+    DA_MEMCPY(&u, &x, sizeof(u));
+    return u >> 31 ? ~u : u | ((uint32_t)1 << 31);
+}
+
+static inline uint64_t
+da_radix_key_f64(double x)
+{
+    uint64_t u;
+
+    DA_MEMCPY(&u, &x, sizeof(u));
+    return u >> 63 ? ~u : u | ((uint64_t)1 << 63);
+}
+
+#define DA_DEFINE_RADIX_SORT(name, T, K, key)                                 \
+    DA__DEFINE_RADIX_SORT(name, T, K, key, void, DA__NO_CTX_PARAM, DA__NO_CTX)
+
+#define DA_DEFINE_RADIX_SORT_CTX(name, T, K, key, CtxT)                       \
+    DA__DEFINE_RADIX_SORT(name, T, K, key, CtxT, DA__CTX_PARAM, DA__CTX)
+
+#define DA__DEFINE_RADIX_SORT(name, T, K, key, CtxT, PARAM, CTX)              \
+    static inline void                                                        \
+    name##__radix_insertion_sort(T *a, size_t n)                              \
+    {                                                                         \
+        size_t i, j;                                                          \
+                                                                              \
+        for (i = 1; i < n; i++) {                                             \
+            T tmp = a[i];                                                     \
+            K k = key(tmp);                                                   \
+            for (j = i; j > 0 && k < key(a[j - 1]); j--)                      \
+                a[j] = a[j - 1];                                              \
+            a[j] = tmp;                                                       \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    static inline int                                                         \
+    name##_radix_sort(PARAM(CtxT) T *items, size_t count)                     \
+    {                                                                         \
+        unsigned bits = sizeof(K) > 4 && count >= DA_RADIX_WIDE ? 11 : 8;     \
+        unsigned passes = (unsigned)((sizeof(K) * 8 + bits - 1) / bits);      \
+        size_t radix = (size_t)1 << bits;                                     \
+        size_t hist_size = sizeof(size_t) * radix * passes, size;             \
+        size_t *hist, i, j, sum;                                              \
+        T *src = items, *dst, *tmp;                                           \
+        unsigned p;                                                           \
+                                                                              \
+        if (count <= DA_SORT__INSERTION) {                                    \
+            name##__radix_insertion_sort(items, count);                       \
+            return 1;                                                         \
+        }                                                                     \
+                                                                              \
+        /* the digit counts, then the scratch items */                        \
+        size = da__add_sat(hist_size, da__mul_sat(count, sizeof(T)));         \
+        if (size == (size_t)-1 ||                                             \
+            !(hist = (size_t *)DA_MALLOC(CTX(ctx), size)))                    \
+            return 0;                                                         \
+        dst = (T *)(void *)(hist + radix * passes);                           \
+                                                                              \
+        DA_MEMSET(hist, 0, hist_size);                                        \
+        for (i = 0; i < count; i++) {                                         \
+            K k = key(items[i]);                                              \
+            for (p = 0; p < passes; p++)                                      \
+                hist[p * radix + (size_t)(k >> (p * bits) & (radix - 1))]++;  \
+        }                                                                     \
+                                                                              \
+        for (p = 0; p < passes; p++) {                                        \
+            size_t *h = hist + p * radix;                                     \
+            unsigned shift = p * bits;                                        \
+                                                                              \
+            /* every item has the same digit, nothing would move */           \
+            if (h[(size_t)(key(src[0]) >> shift & (radix - 1))] == count)     \
+                continue;                                                     \
+                                                                              \
+            for (sum = 0, j = 0; j < radix; j++) {                            \
+                size_t c = h[j];                                              \
+                h[j] = sum;                                                   \
+                sum += c;                                                     \
+            }                                                                 \
+            for (i = 0; i < count; i++)                                       \
+                dst[h[(size_t)(key(src[i]) >> shift & (radix - 1))]++] =      \
+                    src[i];                                                   \
+            tmp = src;                                                        \
+            src = dst;                                                        \
+            dst = tmp;                                                        \
+        }                                                                     \
+                                                                              \
+        if (src != items)                                                     \
+            DA_MEMCPY(items, src, sizeof(T) * count);                         \
+        DA_FREE(CTX(ctx), hist, size);                                        \
+        return 1;                                                             \
+    }                                                                         \
+                                                                              \
+    typedef int name##__define_radix_sort_requires_a_semicolon
+
+#ifdef DA_SORT_PTHREADS
+#include <pthread.h>
+
+#ifndef DA_SORT_MAX_THREADS
+# define DA_SORT_MAX_THREADS 64
+#endif
+
+#ifndef DA_SORT_PARALLEL_MIN
+# define DA_SORT_PARALLEL_MIN 65536
+#endif
+
+#define DA_DEFINE_PARALLEL_SORT(name, T, less)                                \
+    DA__DEFINE_PARALLEL_SORT(name, T, less, void, DA__NO_CTX_PARAM,           \
+                             DA__NO_CTX)
+
+#define DA_DEFINE_PARALLEL_SORT_CTX(name, T, less, CtxT)                      \
+    DA__DEFINE_PARALLEL_SORT(name, T, less, CtxT, DA__CTX_PARAM, DA__CTX)
+
+#define DA__DEFINE_PARALLEL_SORT(name, T, less, CtxT, PARAM, CTX)             \
+    typedef struct {                                                          \
+        T *items, *buf;                                                       \
+        size_t count;                                                         \
+        unsigned threads;                                                     \
+        int merging;                                                          \
+        /* chunk i of `buf' is [bounds[i], bounds[i + 1]) */                  \
+        size_t bounds[DA_SORT_MAX_THREADS + 1];                               \
+    } name##__ParallelJob;                                                    \
+                                                                              \
+    typedef struct {                                                          \
+        name##__ParallelJob *job;                                             \
+        unsigned index;                                                       \
+    } name##__ParallelTask;                                                   \
+                                                                              \
+    /* number of items of the chunks less than (or not greater than if    */  \
+    /* `upper') `v'                                                       */  \
+    static inline size_t                                                      \
+    name##__rank(const name##__ParallelJob *job, const T *v, int upper,       \
+                 size_t *pos)                                                 \
+    {                                                                         \
+        size_t rank = 0, l, h, m;                                             \
+        unsigned i;                                                           \
+                                                                              \
+        for (i = 0; i < job->threads; i++) {                                  \
+            l = job->bounds[i];                                               \
+            h = job->bounds[i + 1];                                           \
+            while (l < h) {                                                   \
+                m = l + (h - l) / 2;                                          \
+                if (upper ? !(less(*v, job->buf[m]))                          \
+                          : (less(job->buf[m], *v)))                          \
+                    l = m + 1;                                                \
+                else                                                          \
+                    h = m;                                                    \
+            }                                                                 \
+            if (pos)                                                          \
+                pos[i] = l;                                                   \
+            rank += l - job->bounds[i];                                       \
+        }                                                                     \
+        return rank;                                                          \
+    }                                                                         \
+                                                                              \
+    /* positions `split' in every chunk such that the `r' items before    */  \
+    /* them are the r smallest ones                                       */  \
+    static inline void                                                        \
+    name##__split(const name##__ParallelJob *job, size_t r, size_t *split)    \
+    {                                                                         \
+        size_t upper[DA_SORT_MAX_THREADS], l, h, m, lower;                    \
+        unsigned i, j;                                                        \
+                                                                              \
+        for (i = 0; i < job->threads; i++)                                    \
+            split[i] = job->bounds[r < job->count ? i : i + 1];               \
+        if (r == 0 || r >= job->count)                                        \
+            return;                                                           \
+                                                                              \
+        /* find the item v of rank r, the last one of its chunk with at   */  \
+        /* most r smaller items                                           */  \
+        for (j = 0; j < job->threads; j++) {                                  \
+            l = job->bounds[j];                                               \
+            h = job->bounds[j + 1];                                           \
+            while (l < h) {                                                   \
+                m = l + (h - l) / 2;                                          \
+                if (name##__rank(job, &job->buf[m], 0, NULL) <= r)            \
+                    l = m + 1;                                                \
+                else                                                          \
+                    h = m;                                                    \
+            }                                                                 \
+            if (l == job->bounds[j] ||                                        \
+                name##__rank(job, &job->buf[l - 1], 1, upper) <= r)           \
+                continue;                                                     \
+                                                                              \
+            /* split before the items equal to v, then take as many of    */  \
+            /* them as needed to reach r                                  */  \
+            lower = name##__rank(job, &job->buf[l - 1], 0, split);            \
+            for (i = 0; i < job->threads && lower < r; i++) {                 \
+                m = upper[i] - split[i] < r - lower ? upper[i] - split[i]     \
+                                                    : r - lower;              \
+                split[i] += m;                                                \
+                lower += m;                                                   \
+            }                                                                 \
+            return;                                                           \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    /* merge the share of the output of thread `t' from `buf' to `items'  */  \
+    static inline void                                                        \
+    name##__merge(const name##__ParallelJob *job, unsigned t)                 \
+    {                                                                         \
+        size_t cur[DA_SORT_MAX_THREADS], end[DA_SORT_MAX_THREADS];            \
+        unsigned heap[DA_SORT_MAX_THREADS], n = 0, i, c, top;                 \
+        size_t out = job->count / job->threads * t;                           \
+        const T *buf = job->buf;                                              \
+                                                                              \
+        name##__split(job, out, cur);                                         \
+        name##__split(job,                                                    \
+                      t + 1 == job->threads ? job->count                      \
+                      : job->count / job->threads * (t + 1),                  \
+                      end);                                                   \
+                                                                              \
+        /* min-heap of the chunks with items left, by their next item */      \
+        for (i = 0; i < job->threads; i++) {                                  \
+            if (cur[i] == end[i])                                             \
+                continue;                                                     \
+            for (c = n++; c > 0 &&                                            \
+                 (less(buf[cur[i]], buf[cur[heap[(c - 1) / 2]]]));            \
+                 c = (c - 1) / 2)                                             \
+                heap[c] = heap[(c - 1) / 2];                                  \
+            heap[c] = i;                                                      \
+        }                                                                     \
+                                                                              \
+        while (n > 0) {                                                       \
+            top = heap[0];                                                    \
+            job->items[out++] = buf[cur[top]++];                              \
+            if (cur[top] == end[top])                                         \
+                top = heap[--n];                                              \
+            for (i = 0; (c = 2 * i + 1) < n; i = c) {                         \
+                if (c + 1 < n &&                                              \
+                    (less(buf[cur[heap[c + 1]]], buf[cur[heap[c]]])))         \
+                    c++;                                                      \
+                if (!(less(buf[cur[heap[c]]], buf[cur[top]])))                \
+                    break;                                                    \
+                heap[i] = heap[c];                                            \
+            }                                                                 \
+            heap[i] = top;                                                    \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    static void *                                                             \
+    name##__parallel_worker(void *arg)                                        \
+    {                                                                         \
+        name##__ParallelTask *task = (name##__ParallelTask *)arg;             \
+        name##__ParallelJob *job = task->job;                                 \
+        size_t lo = job->bounds[task->index];                                 \
+        size_t hi = job->bounds[task->index + 1];                             \
+                                                                              \
+        if (job->merging) {                                                   \
+            name##__merge(job, task->index);                                  \
+        } else {                                                              \
+            DA_MEMCPY(job->buf + lo, job->items + lo, sizeof(T) * (hi - lo)); \
+            name##_sort(job->buf + lo, hi - lo);                              \
+        }                                                                     \
+        return NULL;                                                          \
+    }                                                                         \
+                                                                              \
+    /* run every task of `job', in the calling thread if no thread can be */  \
+    /* created                                                            */  \
+    static inline void                                                        \
+    name##__parallel_run(name##__ParallelJob *job)                            \
+    {                                                                         \
+        name##__ParallelTask tasks[DA_SORT_MAX_THREADS];                      \
+        pthread_t tids[DA_SORT_MAX_THREADS];                                  \
+        int started[DA_SORT_MAX_THREADS];                                     \
+        unsigned i;                                                           \
+                                                                              \
+        for (i = 0; i < job->threads; i++) {                                  \
+            tasks[i].job = job;                                               \
+            tasks[i].index = i;                                               \
+            started[i] = i > 0 && pthread_create(&tids[i], NULL,              \
+                                                 name##__parallel_worker,     \
+                                                 &tasks[i]) == 0;             \
+        }                                                                     \
+        for (i = 0; i < job->threads; i++)                                    \
+            if (!started[i])                                                  \
+                name##__parallel_worker(&tasks[i]);                           \
+        for (i = 1; i < job->threads; i++)                                    \
+            if (started[i])                                                   \
+                pthread_join(tids[i], NULL);                                  \
+    }                                                                         \
+                                                                              \
+    static inline int                                                         \
+    name##_parallel_sort(PARAM(CtxT) T *items, size_t count,                  \
+                         unsigned threads)                                    \
+    {                                                                         \
+        name##__ParallelJob job;                                              \
+        unsigned i;                                                           \
+                                                                              \
+        if (threads > DA_SORT_MAX_THREADS)                                    \
+            threads = DA_SORT_MAX_THREADS;                                    \
+        if (threads > count / DA_SORT_PARALLEL_MIN)                           \
+            threads = (unsigned)(count / DA_SORT_PARALLEL_MIN);               \
+        if (threads <= 1) {                                                   \
+            name##_sort(items, count);                                        \
+            return 1;                                                         \
+        }                                                                     \
+                                                                              \
+        job.buf = (T *)DA_MALLOC(CTX(ctx), sizeof(T) * count);                \
+        if (!job.buf)                                                         \
+            return 0;                                                         \
+        job.items = items;                                                    \
+        job.count = count;                                                    \
+        job.threads = threads;                                                \
+        for (i = 0; i <= threads; i++)                                        \
+            job.bounds[i] = i == threads ? count : count / threads * i;       \
+                                                                              \
+        /* sort a copy of every chunk in `buf', then merge them back */       \
+        job.merging = 0;                                                      \
+        name##__parallel_run(&job);                                           \
+        job.merging = 1;                                                      \
+        name##__parallel_run(&job);                                           \
+                                                                              \
+        DA_FREE(CTX(ctx), job.buf, sizeof(T) * count);                        \
+        return 1;                                                             \
+    }                                                                         \
+                                                                              \
+    typedef int name##__define_parallel_sort_requires_a_semicolon
+#endif // DA_SORT_PTHREADS
+
+#endif // DA_SORT_H
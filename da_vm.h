@@ -0,0 +1,193 @@
+/* da_vm - v1.0 - public domain virtual memory backend for dynamic_array.h
+
+   Each allocation reserves a fixed address range up front with
+   mmap(PROT_NONE) and commits pages with mprotect(2) as it grows, so growing
+   a dynamic array never copies its items and `items' stays at the same
+   address for the whole life of the array.
+
+   Linux/POSIX only, needs MAP_ANONYMOUS and MAP_NORESERVE (compile with
+   _DEFAULT_SOURCE or _GNU_SOURCE when using a strict -std= mode).
+
+   DOCUMENTATION
+     (usage: see provided example)
+
+     DaVm
+       allocator context (`ctx' argument of the da_* macros), `reserve' is
+       the size of the address range reserved for every allocation made
+       through it. a null context falls back to malloc, realloc and free.
+
+     da_vm_alloc(vm, sz)
+       reserve `vm->reserve' bytes and commit the first `sz' of them
+
+     da_vm_realloc(vm, ptr, oldsz, newsz)
+       commit (or decommit) pages so that `newsz' bytes are usable,
+       never moves the allocation, returns NULL and leaves it untouched
+       when `newsz' doesn't fit in the reservation
+
+     da_vm_free(vm, ptr, sz)
+       release the whole reservation
+
+   LICENSE
+
+     Placed in the public domain and also MIT licensed.
+     See end of dynamic_array.h for detailed license information.
+
+   CREDITS
+
+     Listeria monocytogenes
+*/
+
+#ifndef DA_VM_H
+#define DA_VM_H
+
+/** Example (append-only log, benchmarked against realloc) */
+#if 0
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "da_vm.h"
+
+#define DA_MALLOC(ctx, sz)                    da_vm_alloc(ctx, sz)
+#define DA_REALLOC(ctx, oldptr, oldsz, newsz) da_vm_realloc(ctx, oldptr, oldsz, newsz)
+#define DA_FREE(ctx, ptr, sz)                 da_vm_free(ctx, ptr, sz)
+#define DA_GROWTH                             DA_GROWTH_PAGE
+#include "dynamic_array.h"
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* run once as `./log vm N' and once as `./log realloc N', for N from 1M to
+   1G, each run in its own process so that the peak RSS is its own */
+int main(int argc, char **argv)
+{
+    /* 64 GiB of address space, only the pages in use are backed by memory */
+    DaVm vm = { (size_t)64 << 30 };
+    DaVm *ctx;
+    DynamicArray(long) log = DA_INIT;
+    struct rusage ru;
+    long n, *first;
+    double start, elapsed;
+
+    if (argc != 3 || (n = atol(argv[2])) < 1) {
+        fprintf(stderr, "usage: %s vm|realloc count\n", argv[0]);
+        return 1;
+    }
+    /* a null context falls back to malloc, realloc and free */
+    ctx = strcmp(argv[1], "vm") == 0 ? &vm : NULL;
+
+    start = now();
+    da_append(ctx, &log, 0);
+    first = log.items;
+    for (long i = 1; i < n; i++)
+        da_append(ctx, &log, i);
+    elapsed = now() - start;
+
+    getrusage(RUSAGE_SELF, &ru);
+    printf("%s: %ld appends, %.2f ns per append, peak RSS %ld MiB, %s\n",
+           argv[1], n, elapsed * 1e9 / n, ru.ru_maxrss / 1024,
+           first == log.items ? "never moved" : "moved");
+
+    da_free(ctx, &log);
+    return 0;
+}
+#endif
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef struct {
+    size_t reserve;
+} DaVm;
+
+/* `sz' rounded up to whole pages, saturated to the largest multiple of the
+   page size so that it never wraps around to a small size */
+static inline size_t
+da_vm__round(size_t sz)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (sz > (size_t)-1 - (page - 1))
+        return (size_t)-1 / page * page;
+    return (sz + page - 1) / page * page;
+}
+
+static inline void *
+da_vm_alloc(DaVm *vm, size_t sz)
+{
+    size_t reserve, commit;
+    void *p;
+
+    if (!vm)
+        return malloc(sz);
+
+    reserve = da_vm__round(vm->reserve);
+    if (sz > reserve)
+        return NULL;
+    commit = da_vm__round(sz);
+
+    p = mmap(NULL, reserve, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    if (commit > 0 && mprotect(p, commit, PROT_READ | PROT_WRITE) != 0) {
+        munmap(p, reserve);
+        return NULL;
+    }
+
+    return p;
+}
+
+static inline void *
+da_vm_realloc(DaVm *vm, void *ptr, size_t oldsz, size_t newsz)
+{
+    size_t oldcommit, newcommit;
+
+    if (!vm)
+        return realloc(ptr, newsz);
+    if (!ptr)
+        return da_vm_alloc(vm, newsz);
+
+    /* check the size before rounding it, so that a size that doesn't fit
+       fails before any page is touched */
+    if (newsz > da_vm__round(vm->reserve))
+        return NULL;
+    oldcommit = da_vm__round(oldsz);
+    newcommit = da_vm__round(newsz);
+
+    if (newcommit > oldcommit) {
+        if (mprotect((char *)ptr + oldcommit, newcommit - oldcommit,
+                     PROT_READ | PROT_WRITE) != 0)
+            return NULL;
+    } else if (newcommit < oldcommit) {
+        /* give the pages back, the range stays reserved */
+        madvise((char *)ptr + newcommit, oldcommit - newcommit,
+                MADV_DONTNEED);
+        mprotect((char *)ptr + newcommit, oldcommit - newcommit, PROT_NONE);
+    }
+
+    return ptr;
+}
+
+static inline void
+da_vm_free(DaVm *vm, void *ptr, size_t sz)
+{
+    (void)sz;
+
+    if (!vm)
+        free(ptr);
+    else if (ptr)
+        munmap(ptr, da_vm__round(vm->reserve));
+}
+
+#endif // DA_VM_H
@@ -6,9 +6,68 @@
      DynamicArray(T)
        type of a dynamic array of T
 
+     DynamicArrayN(T, SizeT)
+       type of a dynamic array of T whose count and capacity are of the
+       unsigned integer type SizeT instead of da_size (DA_SIZE_T), growing
+       it beyond the largest SizeT fails like an allocation failure
+
+     DynamicArraySmall(T, N)
+       type of a dynamic array of T with inline storage for N elements,
+       it only allocates once it grows beyond its inline storage.
+       it must not be copied or moved while using its inline storage.
+       only the following macros may resize or free it:
+
+       da_small_append, da_small_append_many, da_small_try_append,
+       da_small_try_append_many, da_small_try_reserve, da_small_append_uninit,
+       da_small_insert, da_small_insert_many, da_small_splice,
+       da_small_reserve, da_small_reserve_exact, da_small_shrink_to_fit,
+       da_small_free
+
+       using their da_* counterparts on it is undefined behavior, they
+       would pass the inline storage to DA_REALLOC or DA_FREE, and it is
+       not diagnosed. the da_* macros that don't allocate or free the items
+       (da_pop, da_last, da_foreach, da_memdup...) work on it as is.
+       this departs deliberately from letting the plain da_* macros handle
+       it too: they can't tell it apart from a user-defined array without
+       guessing from the layout, which misdetected user-defined arrays
+
+     DynamicArrayAligned(T, A)
+       type of a dynamic array of T whose items are aligned to A bytes
+       (a power of two, e.g. 64 for AVX-512 loads, or the alignment of an
+       over-aligned T) and whose allocation is padded to a multiple of A,
+       so that full-vector loads past the last item stay in bounds.
+       A must not be smaller than sizeof(void *). only the following
+       macros may resize or free it, or copy its items to an aligned
+       buffer:
+
+       da_aligned_append, da_aligned_append_many, da_aligned_try_append,
+       da_aligned_try_append_many, da_aligned_try_reserve,
+       da_aligned_append_uninit, da_aligned_insert, da_aligned_insert_many,
+       da_aligned_splice, da_aligned_reserve, da_aligned_reserve_exact,
+       da_aligned_shrink_to_fit, da_aligned_memdup, da_aligned_memdup_free,
+       da_aligned_free
+
+       using their da_* counterparts on it is undefined behavior once it
+       has items, they would pass a pointer into the middle of the block
+       to DA_REALLOC or DA_FREE, and it is not diagnosed. the da_* macros
+       that don't allocate or free the items work on it as is, except
+       da_from_parts()
+
+     DA_MALLOC_ALIGNMENT
+       alignment of the blocks returned by DA_MALLOC and DA_REALLOC,
+       defaults to 2 * sizeof(void *), DynamicArrayAligned(T, A) arrays
+       with a larger A allocate A extra bytes and keep their items aligned
+       within them
+
      DA_INIT
        zero value for the dynamic array
 
+     DA_SMALL_INIT
+       zero value for DynamicArraySmall(T, N)
+
+     DA_ALIGNED_INIT
+       zero value for DynamicArrayAligned(T, A)
+
      da_from_parts(items, count, capacity)
        return a dynamic array with the given initial values.
        freeing the dynamic array will free (DA_FREE) with the provided buffer.
@@ -18,14 +77,66 @@
      da_with_capacity(T, ctx, capacity) - uses DA_MALLOC
        return a dynamic array with the given initial capacity
 
+     da_with_capacity_aligned(T, A, ctx, capacity) - uses DA_MALLOC
+       return a DynamicArrayAligned(T, A) with the given initial capacity,
+       it is an initializer like da_from_parts()
+
      da_append(ctx, da, item) - uses DA_REALLOC
        append an item to the dynamic array and
        return the value of the passed in item
 
      da_append_many(ctx, da, items, count) - uses DA_REALLOC
        append `count' items from the provided buffer to the dynamic array
+       (copied with DA_MEMCPY, so the buffer must hold items of the same
+       type, which is checked at compile time, and must not point into the
+       dynamic array itself)
+       unlike the other macros, this is a statement, not an expression
+
+     da_try_append(ctx, da, item) - uses DA_REALLOC
+     da_try_append_many(ctx, da, items, count) - uses DA_REALLOC
+     da_try_reserve(ctx, da, n) - uses DA_REALLOC
+       fallible versions of da_append, da_append_many and da_reserve, they
+       return nonzero on success and zero, leaving the dynamic array as it
+       was, when the allocation fails or DA_BUDGET_CHECK rejects it
+       (`count' and `n' may be evaluated more than once)
+
+     da_append_uninit(ctx, da, n) - uses DA_REALLOC
+       make room for at least `n' more items and return a pointer to the
+       first of them, the items are left uninitialized and are not counted
+       until da_commit() is called (`n' may be evaluated more than once)
+
+     da_commit(da, n)
+       count `n' more items, written past the end of the dynamic array
+       after a call to da_append_uninit()
+
+     da_insert(ctx, da, i, item) - uses DA_REALLOC
+       insert an item before the item at index `i' (`i' may be the count),
+       shifting the following items up by one (`item' is evaluated after
+       the items are shifted, so it must not refer to them)
+       unlike the other macros, this is a statement, not an expression
+
+     da_insert_many(ctx, da, i, items, count) - uses DA_REALLOC
+       insert `count' items from the provided buffer before the item at
+       index `i', with the same requirements as da_append_many()
        unlike the other macros, this is a statement, not an expression
 
+     da_splice(ctx, da, i, n, items, count) - uses DA_REALLOC
+       replace the `n' items starting at index `i' with `count' items from
+       the provided buffer, with the same requirements as da_append_many()
+       unlike the other macros, this is a statement, not an expression
+
+     da_reserve(ctx, da, n) - uses DA_REALLOC
+       make room for at least `n' more items, growing the dynamic array
+       according to DA_GROWTH (`n' may be evaluated more than once)
+
+     da_reserve_exact(ctx, da, n) - uses DA_REALLOC
+       make room for exactly `n' more items if the dynamic array can't
+       already fit them (`n' may be evaluated more than once)
+
+     da_shrink_to_fit(ctx, da) - uses DA_REALLOC and DA_FREE
+       reduce the capacity of the dynamic array to its count, an empty
+       dynamic array is freed and reset to DA_INIT
+
      da_pop(da)
        remove the last element in the dynamic array and return it as an rvalue
 
@@ -35,12 +146,127 @@
        does not evaluate `expr' if the array is not empty
        (the provided expression must evaluate to a value of type T)
 
+     da_pop_many(da, out, n)
+       remove up to `n' items from the end of the dynamic array, copy them to
+       the buffer `out' of the same type in the order they had in the array
+       (with a single DA_MEMCPY) and return how many were removed
+
+     da_drain(da, out)
+       remove every item of the dynamic array, copy them to the buffer `out'
+       and return how many were removed
+
+     da_remove(da, i)
+       remove the item at index `i', shifting the following items down by
+       one (`i' may be evaluated more than once)
+
+     da_remove_range(da, i, n)
+       remove the `n' items starting at index `i', shifting the following
+       items down (`i' and `n' may be evaluated more than once)
+
+     da_swap_remove(da, i)
+       remove the item at index `i' in O(1) by moving the last item in its
+       place, the order of the items is not kept
+
      da_memdup(ctx, da) - uses DA_MALLOC
        allocate a copy of the data contained in the dynamic array
+       (da_aligned_memdup() keeps the alignment of a DynamicArrayAligned)
+
+     da_memdup_free(ctx, da, ptr, count) - uses DA_FREE
+       free a copy of `count' items made by da_memdup() from a dynamic array
+       of the same type as `da' (da_aligned_memdup_free() for a copy made by
+       da_aligned_memdup())
+
+     da_take(da)
+       return the items of the dynamic array and reset it to DA_INIT without
+       copying or freeing anything, the caller owns the returned buffer of
+       `capacity' items (read it before) and frees it like a da_memdup()
+       copy (or a da_aligned_memdup() copy for a DynamicArrayAligned). not
+       valid while a DynamicArraySmall(T, N) uses its inline storage
 
      da_free(ctx, da) - uses DA_FREE
        free the memory allocated by the dynamic array
 
+     DA_DEFINE(name, T);
+       define `name' as DynamicArray(T) along with static inline functions
+       that wrap the da_* macros for it, so that the growth path is compiled
+       once, out of line, instead of at every call site:
+
+       T *name_append(name *da, T item)     - returns a pointer to the
+                                              appended item, valid until
+                                              the array grows
+       void name_append_many(name *da, T const *items, size_t count)
+       void name_reserve(name *da, size_t n)
+       T name_pop(name *da)
+       void name_free(name *da)
+
+     DA_DEFINE_CTX(name, T, CtxT);
+       same as DA_DEFINE() but every function that allocates takes a
+       `CtxT ctx' first argument that is passed to DA_MALLOC, DA_REALLOC
+       and DA_FREE, e.g. name_append(ctx, da, item)
+
+     DA_GROWTH(cap, needed, size)
+       growth policy used by every macro that grows the dynamic array,
+       evaluates to the new capacity of an array of `cap' elements of `size'
+       bytes that must fit at least `needed' elements.
+       defaults to DA_GROWTH_DOUBLE, may be defined to one of the following
+       before including this file (or to a custom expression). the result
+       is clamped to the largest capacity whose size in bytes fits a
+       ptrdiff_t, growing beyond it fails like an allocation failure without
+       calling the allocator:
+
+     DA_GROWTH_DOUBLE  - double the capacity (the default)
+     DA_GROWTH_1_5X    - grow the capacity by 50%
+     DA_GROWTH_GOLDEN  - grow the capacity by ~62% (golden ratio)
+     DA_GROWTH_PAGE    - double the capacity and round it up to DA_PAGE_SIZE
+                         bytes once the array is larger than a page
+     DA_GROWTH_LINEAR  - double the capacity until the array reaches
+                         DA_GROWTH_LINEAR_THRESHOLD bytes, then grow it by
+                         DA_GROWTH_LINEAR_STEP bytes at a time
+
+     DA_USABLE_SIZE(ctx, ptr, sz)
+       optional allocator hook next to DA_MALLOC, DA_REALLOC and DA_FREE,
+       evaluates to the number of usable bytes in the block at `ptr' that
+       was allocated with a size of `sz' bytes. when defined, growing a
+       dynamic array sets its capacity to everything the allocator handed
+       out, and DA_REALLOC and DA_FREE are passed sizes based on it, e.g.:
+
+       #define DA_USABLE_SIZE(ctx, ptr, sz) malloc_usable_size(ptr)
+
+     DA_TRY_EXPAND(ctx, ptr, oldsz, newsz)
+       optional allocator hook tried before DA_REALLOC whenever an array
+       grows, evaluates to nonzero if it resized the block at `ptr' from
+       `oldsz' to `newsz' bytes in place (e.g. jemalloc's xallocx(3) or
+       da_arena_try_expand() from da_arena.h), or to zero if DA_REALLOC
+       should be used instead. items never move when it succeeds.
+
+     DA_BUDGET_CHECK(ctx, oldsz, newsz)
+       optional hook evaluated by the da_try_* macros before they resize a
+       block of `oldsz' bytes (0 for a new block) to `newsz' bytes, they
+       fail without allocating when it evaluates to zero. paired with
+       allocator hooks that account for the bytes in use it caps the
+       memory of each ctx, e.g.:
+
+       #define DA_BUDGET_CHECK(ctx, oldsz, newsz)                             \
+           ((ctx)->used - (oldsz) + (newsz) <= (ctx)->limit)
+
+     DA_STATS
+       optional lvalue of type DaStats (e.g. a global or a thread local
+       variable) that counts reallocations and DA_TRY_EXPAND hits and
+       misses when defined
+
+     StretchyBuffer(T) (`T *' with the count and capacity stored before it)
+       a single pointer handle that can be indexed directly, a null pointer
+       is an empty buffer. there is a corresponding sbuf_* macro for
+       da_append, da_append_many, da_reserve, da_pop, da_pop_or, da_memdup
+       and da_free taking the buffer lvalue instead of a pointer to the
+       dynamic array (`n' and `b' may be evaluated more than once), plus:
+
+     sbuf_count(b)
+       number of items in the stretchy buffer
+
+     sbuf_capacity(b)
+       number of items the stretchy buffer can hold before growing
+
      StringBuilder (DynamicArray specialization for `char': DynamicArray(char))
        may be disabled by defining DA_NO_STRING_BUILDER.
        there is a corresponding sb_* macro for every da_* macro plus the
@@ -53,6 +279,12 @@
      sb_strdup(ctx, sb) - uses DA_MALLOC
        allocates a null-terminated copy of the built string and returns it
 
+     sb_into_cstr(ctx, sb) - uses DA_REALLOC
+       null-terminate the built string in place, shrinking (or growing) its
+       buffer to `count + 1' bytes unless it already has that size, then
+       take the buffer with da_take() and return it. the result is freed
+       like the one of sb_strdup(), with DA_FREE(ctx, s, strlen(s) + 1)
+
    LICENSE
 
      Placed in the public domain and also MIT licensed.
@@ -157,6 +389,148 @@ int main(int argc, char *argv[])
 }
 #endif
 
+/** Example (growth policy) */
+#if 0
+#include <stdio.h>
+#include <stdlib.h>
+
+/* count reallocations to compare growth policies, try DA_GROWTH_DOUBLE,
+ * DA_GROWTH_1_5X, DA_GROWTH_GOLDEN, DA_GROWTH_PAGE and DA_GROWTH_LINEAR */
+static size_t reallocs, peak;
+
+static void *counting_realloc(void *ptr, size_t oldsz, size_t newsz)
+{
+    reallocs++;
+    if (newsz > peak)
+        peak = newsz;
+    return realloc(ptr, newsz);
+}
+
+#define DA_GROWTH                             DA_GROWTH_1_5X
+#define DA_MALLOC(ctx, sz)                    malloc(sz)
+#define DA_REALLOC(ctx, oldptr, oldsz, newsz) counting_realloc(oldptr, oldsz, newsz)
+#define DA_FREE(ctx, ptr, sz)                 free(ptr)
+#include "dynamic_array.h"
+
+int main(void)
+{
+    DynamicArray(int) da = DA_INIT;
+
+    for (int i = 0; i < 100000000; i++)
+        da_append(, &da, i);
+
+    printf("%zu reallocations, largest buffer: %zu bytes, used: %zu bytes\n",
+           reallocs, peak, da.count * sizeof(*da.items));
+
+    da_free(, &da);
+    return 0;
+}
+#endif
+
+/** Example (bulk append) */
+#if 0
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dynamic_array.h"
+
+typedef struct { char bytes[64]; } Block;
+
+/* the per-item loop that da_append_many used before it copied the items
+ * with a single DA_MEMCPY, re-reading the count for every item */
+#define loop_append_many(da, src, n)                                   \
+    do {                                                               \
+        da_reserve(, da, n);                                           \
+        for (size_t i_ = 0; i_ < (size_t)(n); i_++)                    \
+            (da)->items[(da)->count++] = (src)[i_];                    \
+    } while (0)
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* append a 1 MiB buffer 1000 times to an array emptied each time, after
+ * the first round it only copies, the seconds it takes are the
+ * milliseconds per MiB */
+#define BENCH(T, append)                                               \
+    do {                                                               \
+        size_t n = ((size_t)1 << 20) / sizeof(T);                      \
+        T *src = (T *)malloc(n * sizeof(T));                           \
+        DynamicArray(T) da = DA_INIT;                                  \
+        unsigned sink = 0;                                             \
+        double start;                                                  \
+                                                                       \
+        memset(src, 1, n * sizeof(T));                                 \
+        start = now();                                                 \
+        for (int r = 0; r < 1000; r++) {                               \
+            da.count = 0;                                              \
+            append;                                                    \
+            sink += ((unsigned char *)da.items)[r];                    \
+        }                                                              \
+        printf("%-5s %-30s %.3f ms/MiB (%u)\n",                        \
+               #T, #append, now() - start, sink);                      \
+        da_free(, &da);                                                \
+        free(src);                                                     \
+    } while (0)
+
+int main(void)
+{
+    BENCH(char, loop_append_many(&da, src, n));
+    BENCH(char, da_append_many(, &da, src, n));
+    BENCH(int, loop_append_many(&da, src, n));
+    BENCH(int, da_append_many(, &da, src, n));
+    BENCH(Block, loop_append_many(&da, src, n));
+    BENCH(Block, da_append_many(, &da, src, n));
+
+#ifdef CHECK_MIXED_TYPES
+    /* must not compile: the items are copied, not converted, so appending
+     * ints to an array of floats is rejected instead of storing their bits */
+    {
+        DynamicArray(float) floats = DA_INIT;
+        int ints[3] = {1, 2, 3};
+
+        da_append_many(, &floats, ints, 3);
+    }
+#endif
+
+    return 0;
+}
+#endif
+
+/** Example (typed functions) */
+#if 0
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dynamic_array.h"
+
+DA_DEFINE(Ints, int);
+
+int main(void)
+{
+    Ints da = DA_INIT;
+    long sum = 0;
+
+    /* each call is a compare, a store and an increment, the growth path
+     * lives in a single out of line function shared by every call site */
+    for (int i = 0; i < 100000000; i++)
+        Ints_append(&da, i);
+
+    while (da.count > 0)
+        sum += Ints_pop(&da);
+    printf("%ld\n", sum);
+
+    Ints_free(&da);
+    return 0;
+}
+#endif
+
 /** Example (custom allocators) */
 #if 0
 #define DA_MALLOC(ctx, sz)                    my_alloc(ctx, sz)
@@ -178,20 +552,145 @@ int main(int argc, char *argv[])
 #endif
 
 /* More standard library stuff */
+#if !defined(DA_MEMSET) || !defined(DA_MEMCPY) || !defined(DA_MEMMOVE) ||     \
+    !defined(DA_STRLEN)
+# include <string.h>
+#endif
 #ifndef DA_MEMSET
 # define DA_MEMSET(s, c, n) memset((s), (c), (n))
 #endif
 #ifndef DA_MEMCPY
 # define DA_MEMCPY(dst, src, n) memcpy((dst), (src), (n))
 #endif
+#ifndef DA_MEMMOVE
+# define DA_MEMMOVE(dst, src, n) memmove((dst), (src), (n))
+#endif
 #ifndef DA_STRLEN
 # define DA_STRLEN(s) strlen((s))
 #endif
+#include <stdint.h>
+
+/* Growth statistics */
+typedef struct {
+    size_t reallocs;      /* calls to DA_REALLOC made to grow an array */
+    size_t expand_hits;   /* arrays grown in place by DA_TRY_EXPAND */
+    size_t expand_misses; /* DA_TRY_EXPAND failures */
+} DaStats;
+
+#ifdef DA_STATS
+# define DA__STAT(field) ((DA_STATS).field++)
+#else
+# define DA__STAT(field) (void)0
+#endif
 
 #ifndef DA_INIT_CAPACITY
 # define DA_INIT_CAPACITY 16
 #endif
 
+/* Growth policies */
+#ifndef DA_GROWTH
+# define DA_GROWTH DA_GROWTH_DOUBLE
+#endif
+
+#ifndef DA_PAGE_SIZE
+# define DA_PAGE_SIZE 4096
+#endif
+
+#ifndef DA_GROWTH_LINEAR_THRESHOLD
+# define DA_GROWTH_LINEAR_THRESHOLD ((size_t)64 << 20)
+#endif
+
+#ifndef DA_GROWTH_LINEAR_STEP
+# define DA_GROWTH_LINEAR_STEP DA_GROWTH_LINEAR_THRESHOLD
+#endif
+
+/* branch hint for the growth checks (for private use) */
+#if defined(__GNUC__)
+# define DA__UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+# define DA__UNLIKELY(x) (x)
+#endif
+
+/* keep a function out of the hot path (for private use) */
+#if defined(__GNUC__)
+# define DA__COLD __attribute__((noinline, cold, unused))
+#elif defined(_MSC_VER)
+# define DA__COLD __declspec(noinline)
+#else
+# define DA__COLD
+#endif
+
+/* the null result of a capacity that the dynamic array can't represent,
+   which fails like an allocation failure without ever passing its size to
+   the allocator. it is read through a volatile so that the compiler can't
+   see that it is null and diagnose the code that runs after the failure
+   (for private use) */
+static DA__COLD void *
+da__capacity_overflow(void)
+{
+    static void *volatile null;
+
+    return null;
+}
+
+#define DA__MAX(a, b) ((a) > (b) ? (a) : (b))
+#define DA__MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* sizes and capacities saturated to SIZE_MAX, which no dynamic array can
+   have, so that an overflow fails the capacity checks (for private use) */
+static inline size_t
+da__add_sat(size_t a, size_t b)
+{
+    return b > (size_t)-1 - a ? (size_t)-1 : a + b;
+}
+
+static inline size_t
+da__mul_sat(size_t a, size_t b)
+{
+#if defined(__GNUC__) && __GNUC__ >= 5 || defined(__clang__)
+    size_t r;
+
+    return __builtin_mul_overflow(a, b, &r) ? (size_t)-1 : r;
+#else
+    return b > 0 && a > (size_t)-1 / b ? (size_t)-1 : a * b;
+#endif
+}
+
+/* `n' items of `size' bytes rounded up to whole pages (for private use) */
+static inline size_t
+da__round_to_page(size_t n, size_t size)
+{
+    size_t bytes = da__mul_sat(n, size);
+
+    if (bytes < DA_PAGE_SIZE || bytes > (size_t)-1 - (DA_PAGE_SIZE - 1))
+        return n;
+    return (bytes + DA_PAGE_SIZE - 1) / DA_PAGE_SIZE * DA_PAGE_SIZE / size;
+}
+
+/* never return less than `needed', start empty arrays at DA_INIT_CAPACITY */
+#define DA__GROWTH(cap, needed, next)                                         \
+    DA__MAX((size_t)(needed), (cap) > 0 ? (size_t)(next) :                    \
+                                          (size_t)DA_INIT_CAPACITY)
+
+#define DA_GROWTH_DOUBLE(cap, needed, size)                                   \
+    DA__GROWTH(cap, needed, da__add_sat((cap), (cap)))
+
+#define DA_GROWTH_1_5X(cap, needed, size)                                     \
+    DA__GROWTH(cap, needed, da__add_sat((cap), (size_t)(cap) / 2))
+
+#define DA_GROWTH_GOLDEN(cap, needed, size)                                   \
+    DA__GROWTH(cap, needed,                                                   \
+               da__add_sat((cap), (size_t)(cap) / 2 + (size_t)(cap) / 8))
+
+#define DA_GROWTH_PAGE(cap, needed, size)                                     \
+    da__round_to_page(DA_GROWTH_DOUBLE(cap, needed, size), (size))
+
+#define DA_GROWTH_LINEAR(cap, needed, size)                                   \
+    ((size_t)(cap) < DA_GROWTH_LINEAR_THRESHOLD / (size) ?                    \
+     DA_GROWTH_DOUBLE(cap, needed, size) :                                    \
+     DA__GROWTH(cap, needed,                                                  \
+                da__add_sat((cap), DA_GROWTH_LINEAR_STEP / (size))))
+
 /* type of count and capacity fields */
 #ifdef DA_SIZE_T
 typedef DA_SIZE_T da_size;
@@ -213,16 +712,53 @@ typedef size_t da_size;
 #endif
 
 /* Definitions */
-#define DynamicArray(T) struct {                                              \
+#define DynamicArrayN(T, SizeT) struct {                                      \
+    T *DA_ITEMS_FIELD;                                                        \
+    SizeT DA_COUNT_FIELD;                                                     \
+    SizeT DA_CAPACITY_FIELD;                                                  \
+}
+
+#define DynamicArray(T) DynamicArrayN(T, da_size)
+
+/* the inline storage is only used by the da_small_* macros, which name it */
+#define DynamicArraySmall(T, N) struct {                                      \
     T *DA_ITEMS_FIELD;                                                        \
     da_size DA_COUNT_FIELD;                                                   \
     da_size DA_CAPACITY_FIELD;                                                \
+    T da__inline[N];                                                          \
+}
+
+/* the alignment is only used by the da_aligned_* macros, which read it from
+   the size of the array type the marker points to */
+#define DynamicArrayAligned(T, A) struct {                                    \
+    T *DA_ITEMS_FIELD;                                                        \
+    da_size DA_COUNT_FIELD;                                                   \
+    da_size DA_CAPACITY_FIELD;                                                \
+    char (*da__alignment)[A];                                                 \
 }
 
 #define DA_INIT da_from_parts(0, 0, 0)
 
+#ifdef __cplusplus
+# define DA_SMALL_INIT {}
+#else
+# define DA_SMALL_INIT {0}
+#endif
+
+#define DA_ALIGNED_INIT DA_SMALL_INIT
+
 #define da_with_capacity(T, ctx, capacity)                                    \
-    da_from_parts((T*)DA_MALLOC((ctx), (capacity) * sizeof(T)), 0, capacity)
+    da_from_parts((T*)DA_MALLOC((ctx), da__mul_sat((capacity), sizeof(T))),   \
+                  0, capacity)
+
+#define da_with_capacity_aligned(T, A, ctx, capacity)                         \
+    { (T*)((A) > DA_MALLOC_ALIGNMENT ?                                        \
+           da__align_block(                                                   \
+               DA_MALLOC((ctx), da__aligned_size(                             \
+                   da__mul_sat((capacity), sizeof(T)), (A))),                 \
+               (A), 0) :                                                      \
+           (void *)DA_MALLOC((ctx), da__mul_sat((capacity), sizeof(T)))),     \
+      0, (capacity), 0 }
 
 #define da_from_parts(items, count, capacity) { (items), (count), (capacity) }
 
@@ -232,40 +768,434 @@ typedef size_t da_size;
 # define DA__CAST(T)
 #endif
 
-#define da_append(ctx, da, item)                                              \
-    (((da)->DA_COUNT_FIELD == (da)->DA_CAPACITY_FIELD ?                       \
-     (da)->DA_ITEMS_FIELD = DA__CAST((da)->DA_ITEMS_FIELD)DA_REALLOC(         \
-         (ctx),                                                               \
-         (da)->DA_ITEMS_FIELD,                                                \
-         sizeof(*(da)->DA_ITEMS_FIELD) * (da)->DA_CAPACITY_FIELD,             \
-         sizeof(*(da)->DA_ITEMS_FIELD) * ((da)->DA_CAPACITY_FIELD > 0 ?       \
-                                          (da)->DA_CAPACITY_FIELD * 2 :       \
-                                          DA_INIT_CAPACITY)),                 \
-     (da)->DA_CAPACITY_FIELD = ((da)->DA_CAPACITY_FIELD > 0 ?                 \
-                                (da)->DA_CAPACITY_FIELD * 2 :                 \
-                                DA_INIT_CAPACITY) : 0),                       \
+#ifndef DA_MALLOC_ALIGNMENT
+# define DA_MALLOC_ALIGNMENT (2 * sizeof(void *))
+#endif
+
+/* items of an over-aligned dynamic array live `off' bytes into their block,
+   `off' is stored both at the start of the block and right before the
+   items so that it can be found from either (for private use) */
+#define DA__ALIGNMENT(S, da) ((size_t)S##_ALIGNMENT(da))
+
+#define DA__OVERALIGNED(S, da) (DA__ALIGNMENT(S, da) > DA_MALLOC_ALIGNMENT)
+
+/* size of a block for `sz' bytes of items aligned to `align', saturated
+   so that da_with_capacity_aligned() fails when it overflows
+   (for private use) */
+static inline size_t
+da__aligned_size(size_t sz, size_t align)
+{
+    if (sz > (size_t)-1 - 2 * align)
+        return (size_t)-1;
+    return ((sz + align - 1) & ~(align - 1)) + align;
+}
+
+/* align the items within a block returned by DA_MALLOC or DA_REALLOC,
+   moving the first `n' bytes of them if the block was reallocated to an
+   address with a different alignment (for private use) */
+static inline void *
+da__align_block(void *block, size_t align, size_t n)
+{
+    char *p = (char *)block;
+    size_t off, old;
+
+    if (!p)
+        return p;
+
+    off = align - (size_t)((uintptr_t)p & (align - 1));
+    if (n > 0) {
+        DA_MEMCPY(&old, p, sizeof(old));
+        if (old != off)
+            DA_MEMMOVE(p + off, p + old, n);
+    }
+    DA_MEMCPY(p, &off, sizeof(off));
+    DA_MEMCPY(p + off - sizeof(off), &off, sizeof(off));
+    return p + off;
+}
+
+/* block of the aligned items at `ptr' (for private use) */
+static inline void *
+da__aligned_block(void *ptr)
+{
+    size_t off;
+
+    if (!ptr)
+        return ptr;
+
+    DA_MEMCPY(&off, (char *)ptr - sizeof(off), sizeof(off));
+    return (char *)ptr - off;
+}
+
+/* block and size in bytes of the allocation of a dynamic array
+   (for private use) */
+#define DA__ALLOC_PTR(S, da, ptr)                                             \
+    (DA__OVERALIGNED(S, da) ? da__aligned_block((void *)(ptr)) : (void *)(ptr))
+
+#define DA__ALLOC_SIZE(S, da, n)                                              \
+    (DA__OVERALIGNED(S, da) ? da__aligned_size(DA__BYTES(da, n),              \
+                                            DA__ALIGNMENT(S, da)) :           \
+     DA__BYTES(da, n))
+
+/* allocate or reallocate the items of the dynamic array to fit `cap' items
+   (for private use) */
+#define da__malloc_items(S, ctx, da, cap)                                     \
+    DA__CAST((da)->DA_ITEMS_FIELD)(                                           \
+        DA__OVERALIGNED(S, da) ?                                              \
+        da__align_block(DA_MALLOC((ctx), DA__ALLOC_SIZE(S, da, cap)),         \
+                        DA__ALIGNMENT(S, da), 0) :                            \
+        (void *)DA_MALLOC((ctx), DA__BYTES(da, cap)))
+
+#define da__realloc_items(S, ctx, da, cap)                                    \
+    DA__CAST((da)->DA_ITEMS_FIELD)(                                           \
+        DA__OVERALIGNED(S, da) ?                                              \
+        da__align_block(                                                      \
+            DA_REALLOC((ctx),                                                 \
+                       DA__ALLOC_PTR(S, da, (da)->DA_ITEMS_FIELD),            \
+                       (da)->DA_ITEMS_FIELD ?                                 \
+                       DA__ALLOC_SIZE(S, da, (da)->DA_CAPACITY_FIELD) : 0,    \
+                       DA__ALLOC_SIZE(S, da, cap)),                           \
+            DA__ALIGNMENT(S, da),                                             \
+            sizeof(*(da)->DA_ITEMS_FIELD) * (da)->DA_COUNT_FIELD) :           \
+        (void *)DA_REALLOC((ctx),                                             \
+                           (da)->DA_ITEMS_FIELD,                              \
+                           DA__BYTES(da, (da)->DA_CAPACITY_FIELD),            \
+                           DA__BYTES(da, cap)))
+
+#define da__free_items(S, ctx, da, ptr, n)                                    \
+    DA_FREE((ctx), DA__ALLOC_PTR(S, da, ptr), DA__ALLOC_SIZE(S, da, n))
+
+/* capacity of the dynamic array after `items' was (re)allocated to fit
+   `cap' items, taking whatever the allocator rounded up (for private use) */
+#ifdef DA_USABLE_SIZE
+# define da__usable_capacity(S, ctx, da, cap)                                 \
+    (DA__OVERALIGNED(S, da) ? da__padded_capacity(S, da, cap) :               \
+     (da)->DA_ITEMS_FIELD ?                                                   \
+     DA__MIN(DA_USABLE_SIZE((ctx), (da)->DA_ITEMS_FIELD, DA__BYTES(da, cap))  \
+             / sizeof(*(da)->DA_ITEMS_FIELD),                                 \
+             DA__SIZE_MAX((da)->DA_CAPACITY_FIELD)) : (cap))
+#else
+# define da__usable_capacity(S, ctx, da, cap)                                 \
+    (DA__OVERALIGNED(S, da) ? da__padded_capacity(S, da, cap) : (cap))
+#endif
+
+/* over-aligned arrays get the items that fit in the padding of their block
+   (for private use) */
+#define da__padded_capacity(S, da, cap)                                       \
+    ((da)->DA_ITEMS_FIELD ?                                                   \
+     DA__MIN((DA__ALLOC_SIZE(S, da, cap) - DA__ALIGNMENT(S, da)) /            \
+             sizeof(*(da)->DA_ITEMS_FIELD),                                   \
+             DA__SIZE_MAX((da)->DA_CAPACITY_FIELD)) : (size_t)(cap))
+
+/* storage kinds, the first argument `S' of the da__* macros that allocate
+   or free the items: DA__HEAP for the da_* macros, DA__SMALL for the
+   da_small_* macros, which also use the inline storage of a
+   DynamicArraySmall(T, N), and DA__ALIGNED for the da_aligned_* macros,
+   which align the items of a DynamicArrayAligned(T, A). every S##_* macro
+   of DA__HEAP is a constant 0 so that the other cases fold away
+   (for private use) */
+#define DA__HEAP_ALIGNMENT(da)             0
+#define DA__HEAP_INLINE_CAPACITY(da)       0
+#define DA__HEAP_IS_INLINE(da)             0
+#define DA__HEAP_TO_INLINE(ctx, da)        0
+#define DA__HEAP_TO_HEAP(ctx, da, cap)     0
+#define DA__HEAP_TRY_TO_HEAP(ctx, da, cap) 0
+
+#define DA__ALIGNED_ALIGNMENT(da)             sizeof(*(da)->da__alignment)
+#define DA__ALIGNED_INLINE_CAPACITY(da)       0
+#define DA__ALIGNED_IS_INLINE(da)             0
+#define DA__ALIGNED_TO_INLINE(ctx, da)        0
+#define DA__ALIGNED_TO_HEAP(ctx, da, cap)     0
+#define DA__ALIGNED_TRY_TO_HEAP(ctx, da, cap) 0
+
+#define DA__SMALL_ALIGNMENT(da) 0
+
+#define DA__SMALL_INLINE_CAPACITY(da)                                         \
+    (sizeof((da)->da__inline) / sizeof(*(da)->da__inline))
+
+#define DA__SMALL_IS_INLINE(da)                                               \
+    ((void *)(da)->DA_ITEMS_FIELD == (void *)(da)->da__inline)
+
+/* move the items of the dynamic array to its inline storage
+   (for private use) */
+#define DA__SMALL_TO_INLINE(ctx, da)                                          \
+    ((da)->DA_ITEMS_FIELD ?                                                   \
+     (DA_MEMCPY((da)->da__inline,                                             \
+                (da)->DA_ITEMS_FIELD,                                         \
+                sizeof(*(da)->DA_ITEMS_FIELD) * (da)->DA_COUNT_FIELD),        \
+      da__free_items(DA__SMALL, ctx, da,                                      \
+                     (da)->DA_ITEMS_FIELD, (da)->DA_CAPACITY_FIELD),          \
+      0) : 0,                                                                 \
+     (da)->DA_ITEMS_FIELD = (da)->da__inline,                                 \
+     (da)->DA_CAPACITY_FIELD = DA__SMALL_INLINE_CAPACITY(da))
+
+/* move the items of the dynamic array from its inline storage to a new
+   buffer of more than the inline capacity. the whole inline storage is
+   copied, a size that the compiler can bound unlike the count
+   (for private use) */
+#define DA__SMALL_TO_HEAP(ctx, da, cap)                                       \
+    ((da)->DA_ITEMS_FIELD = DA__CAST((da)->DA_ITEMS_FIELD)DA_MEMCPY(          \
+         da__malloc_items(DA__SMALL, ctx, da, cap),                           \
+         (da)->da__inline,                                                    \
+         sizeof((da)->da__inline)),                                           \
+     (da)->DA_CAPACITY_FIELD = da__usable_capacity(DA__SMALL, ctx, da, cap))
+
+#define da__fits_inline(S, da, n)                                             \
+    (S##_INLINE_CAPACITY(da) > 0 && (size_t)(n) <= S##_INLINE_CAPACITY(da))
+
+#define da__is_inline(S, da) S##_IS_INLINE(da)
+
+/* try to grow `items' in place with DA_TRY_EXPAND (for private use) */
+#ifdef DA_TRY_EXPAND
+# define da__try_expand(S, ctx, da, cap)                                      \
+    ((da)->DA_ITEMS_FIELD && (size_t)(cap) > (da)->DA_CAPACITY_FIELD &&       \
+     (DA_TRY_EXPAND((ctx),                                                    \
+                    DA__ALLOC_PTR(S, da, (da)->DA_ITEMS_FIELD),               \
+                    DA__ALLOC_SIZE(S, da, (da)->DA_CAPACITY_FIELD),           \
+                    DA__ALLOC_SIZE(S, da, cap)) ?                             \
+      (DA__STAT(expand_hits), 1) : (DA__STAT(expand_misses), 0)))
+#else
+# define da__try_expand(S, ctx, da, cap) 0
+#endif
+
+#define da__realloc(S, ctx, da, cap)                                          \
+    ((void)(da__try_expand(S, ctx, da, cap) ||                                \
+            (DA__STAT(reallocs),                                              \
+             (da)->DA_ITEMS_FIELD = da__realloc_items(S, ctx, da, cap))),     \
+     (da)->DA_CAPACITY_FIELD = da__usable_capacity(S, ctx, da, cap))
+
+/* set the capacity of the dynamic array to `cap', which is at most
+   DA__MAX_CAPACITY(S, da) (for private use) */
+#define da__set_capacity(S, ctx, da, cap)                                     \
+    (da__fits_inline(S, da, cap) ?                                            \
+     (da__is_inline(S, da) ? 0 : S##_TO_INLINE(ctx, da)) :                    \
+     da__is_inline(S, da) ? S##_TO_HEAP(ctx, da, cap) :                       \
+     da__realloc(S, ctx, da, cap))
+
+/* fail to set a capacity the dynamic array can't have like an allocation
+   failure, without calling the allocator (for private use) */
+#define da__capacity_failure(da)                                              \
+    ((da)->DA_ITEMS_FIELD =                                                   \
+         DA__CAST((da)->DA_ITEMS_FIELD)da__capacity_overflow(), 0)
+
+/* largest value of the unsigned integer lvalue `x' (for private use) */
+#define DA__SIZE_MAX(x)                                                       \
+    ((size_t)-1 >> (sizeof(size_t) - DA__MIN(sizeof(x), sizeof(size_t))) * 8)
+
+/* largest size in bytes of an object, PTRDIFF_MAX (for private use) */
+#define DA__MAX_SIZE ((size_t)-1 >> 1)
+
+/* largest capacity that both the capacity field and the size in bytes of
+   the items, with their alignment padding, can represent (for private use) */
+#define DA__MAX_CAPACITY(S, da)                                               \
+    DA__MIN(DA__SIZE_MAX((da)->DA_CAPACITY_FIELD),                            \
+            (DA__MAX_SIZE - 2 * DA__ALIGNMENT(S, da)) /                       \
+            sizeof(*(da)->DA_ITEMS_FIELD))
+
+/* whether the dynamic array can have a capacity of `n', growing it beyond
+   fails through da__capacity_overflow() (for private use) */
+#define da__checked_capacity(S, da, n)                                        \
+    ((size_t)(n) <= DA__MAX_CAPACITY(S, da))
+
+/* size in bytes of `n' items, `n' is at most DA__MAX_CAPACITY(S, da)
+   (for private use) */
+#define DA__BYTES(da, n)                                                      \
+    ((size_t)(n) * sizeof(*(da)->DA_ITEMS_FIELD))
+
+/* capacity the dynamic array grows to in order to fit `needed' items,
+   clamped to DA__MAX_CAPACITY(S, da) (for private use) */
+#define da__next_capacity(S, da, needed)                                      \
+    (da__fits_inline(S, da, needed) ? (size_t)S##_INLINE_CAPACITY(da) :       \
+     DA__MIN(DA_GROWTH((da)->DA_CAPACITY_FIELD,                               \
+                       (needed),                                              \
+                       sizeof(*(da)->DA_ITEMS_FIELD)),                        \
+             DA__MAX_CAPACITY(S, da)))
+
+/* grow the dynamic array according to DA_GROWTH so that it fits at least
+   `needed' items (for private use) */
+#define da__grow(S, ctx, da, needed)                                          \
+    (DA__UNLIKELY((needed) > (da)->DA_CAPACITY_FIELD) ?                       \
+     (DA__UNLIKELY(!da__checked_capacity(S, da, needed)) ?                    \
+      da__capacity_failure(da) :                                              \
+      da__set_capacity(S, ctx, da, da__next_capacity(S, da, needed))) : 0)
+
+/* reject at compile time a buffer that can't be copied to or from the
+   items with DA_MEMCPY, which doesn't convert them: subtracting the
+   pointers only compiles when they point to the same type, ignoring
+   qualifiers (for private use) */
+#define DA__CHECK_SAME_TYPE(p, q) ((void)sizeof((p) - (q)))
+
+#define da_append(ctx, da, item) da__append(DA__HEAP, ctx, da, item)
+
+#define da__append(S, ctx, da, item)                                          \
+    (da__grow(S, ctx, da, (size_t)(da)->DA_COUNT_FIELD + 1),                  \
      (da)->DA_ITEMS_FIELD[(da)->DA_COUNT_FIELD++] = (item))
 
 #define da_append_many(ctx, da, items, count)                                 \
+    da__append_many(DA__HEAP, ctx, da, items, count)
+
+#define da__append_many(S, ctx, da, items, count)                             \
     do {                                                                      \
-        da_size da__count = (count);                                          \
-        if ((da)->DA_COUNT_FIELD + da__count > (da)->DA_CAPACITY_FIELD) {     \
-            da_size da_size__v = ((da)->DA_CAPACITY_FIELD > 0 ?               \
-                                  (da)->DA_CAPACITY_FIELD * 2 :               \
-                                  DA_INIT_CAPACITY);                          \
-            while (da_size__v < (da)->DA_COUNT_FIELD + da__count)             \
-                da_size__v *= 2;                                              \
-            (da)->DA_ITEMS_FIELD = DA__CAST((da)->DA_ITEMS_FIELD)DA_REALLOC(  \
-                (ctx),                                                        \
-                (da)->DA_ITEMS_FIELD,                                         \
-                sizeof(*(da)->DA_ITEMS_FIELD) * (da)->DA_CAPACITY_FIELD,      \
-                sizeof(*(da)->DA_ITEMS_FIELD) * da_size__v);                  \
-            (da)->DA_CAPACITY_FIELD = da_size__v;                             \
+        size_t da__count = (count);                                           \
+        DA__CHECK_SAME_TYPE((items), (da)->DA_ITEMS_FIELD);                   \
+        if (da__count > 0) {                                                  \
+            da__grow(S, ctx, da,                                              \
+                     da__add_sat((da)->DA_COUNT_FIELD, da__count));           \
+            DA_MEMCPY((da)->DA_ITEMS_FIELD + (da)->DA_COUNT_FIELD,            \
+                      (items),                                                \
+                      sizeof(*(da)->DA_ITEMS_FIELD) * da__count);             \
+            (da)->DA_COUNT_FIELD += da__count;                                \
         }                                                                     \
-        for (da_size da__i = 0; da__i < da__count; da__i++)                   \
-            (da)->DA_ITEMS_FIELD[(da)->DA_COUNT_FIELD++] = (items)[da__i];    \
     } while (0)
 
+/* store `p' in the pointer at `pp' unless it is null, return whether it
+   was stored (for private use) */
+static inline int
+da__store_ptr(void *pp, void *p)
+{
+    if (!p)
+        return 0;
+    DA_MEMCPY(pp, &p, sizeof(p));
+    return 1;
+}
+
+#ifdef DA_BUDGET_CHECK
+# define da__budget_check(S, ctx, da, cap)                                    \
+    DA_BUDGET_CHECK((ctx),                                                    \
+                    (da)->DA_ITEMS_FIELD && !da__is_inline(S, da) ?           \
+                    DA__ALLOC_SIZE(S, da, (da)->DA_CAPACITY_FIELD) : 0,       \
+                    DA__ALLOC_SIZE(S, da, cap))
+#else
+# define da__budget_check(S, ctx, da, cap) 1
+#endif
+
+/* fallible versions of S##_TO_HEAP, da__realloc and da__set_capacity, they
+   evaluate to zero and leave the dynamic array untouched if the allocation
+   fails (for private use) */
+#define DA__SMALL_TRY_TO_HEAP(ctx, da, cap)                                   \
+    (da__store_ptr(&(da)->DA_ITEMS_FIELD,                                     \
+                   da__malloc_items(DA__SMALL, ctx, da, cap)) ?               \
+     (DA_MEMCPY((da)->DA_ITEMS_FIELD,                                         \
+                (da)->da__inline,                                             \
+                sizeof((da)->da__inline)),                                    \
+      (da)->DA_CAPACITY_FIELD = da__usable_capacity(DA__SMALL, ctx, da, cap), \
+      1) : 0)
+
+#define da__try_realloc(S, ctx, da, cap)                                      \
+    ((da__try_expand(S, ctx, da, cap) ||                                      \
+      (DA__STAT(reallocs),                                                    \
+       da__store_ptr(&(da)->DA_ITEMS_FIELD,                                   \
+                     da__realloc_items(S, ctx, da, cap)))) ?                  \
+     ((da)->DA_CAPACITY_FIELD = da__usable_capacity(S, ctx, da, cap), 1) : 0)
+
+#define da__try_set_capacity(S, ctx, da, cap)                                 \
+    (da__fits_inline(S, da, cap) ?                                            \
+     ((void)(da__is_inline(S, da) ? 0 : S##_TO_INLINE(ctx, da)), 1) :         \
+     !da__budget_check(S, ctx, da, cap) ? 0 :                                 \
+     da__is_inline(S, da) ? S##_TRY_TO_HEAP(ctx, da, cap) :                   \
+     da__try_realloc(S, ctx, da, cap))
+
+#define da__try_grow(S, ctx, da, needed)                                      \
+    (DA__UNLIKELY((needed) > (da)->DA_CAPACITY_FIELD) ?                       \
+     (DA__UNLIKELY(!da__checked_capacity(S, da, needed)) ?                    \
+      da__capacity_overflow() != 0 :                                          \
+      da__try_set_capacity(S, ctx, da, da__next_capacity(S, da, needed))) : 1)
+
+#define da_try_append(ctx, da, item) da__try_append(DA__HEAP, ctx, da, item)
+
+#define da__try_append(S, ctx, da, item)                                      \
+    (da__try_grow(S, ctx, da, (size_t)(da)->DA_COUNT_FIELD + 1) ?             \
+     ((da)->DA_ITEMS_FIELD[(da)->DA_COUNT_FIELD++] = (item), 1) : 0)
+
+#define da_try_append_many(ctx, da, items, count)                             \
+    da__try_append_many(DA__HEAP, ctx, da, items, count)
+
+#define da__try_append_many(S, ctx, da, items, count)                         \
+    (DA__CHECK_SAME_TYPE((items), (da)->DA_ITEMS_FIELD),                      \
+     da__try_reserve(S, ctx, da, count) ?                                     \
+     ((size_t)(count) > 0 ?                                                   \
+      (DA_MEMCPY((da)->DA_ITEMS_FIELD + (da)->DA_COUNT_FIELD,                 \
+                 (items),                                                     \
+                 sizeof(*(da)->DA_ITEMS_FIELD) * (count)),                    \
+       (da)->DA_COUNT_FIELD += (count)) : 0, 1) : 0)
+
+#define da_try_reserve(ctx, da, n) da__try_reserve(DA__HEAP, ctx, da, n)
+
+#define da__try_reserve(S, ctx, da, n)                                        \
+    da__try_grow(S, ctx, da, da__add_sat((da)->DA_COUNT_FIELD, (n)))
+
+#define da_append_uninit(ctx, da, n) da__append_uninit(DA__HEAP, ctx, da, n)
+
+#define da__append_uninit(S, ctx, da, n)                                      \
+    (da__grow(S, ctx, da, da__add_sat((da)->DA_COUNT_FIELD, (n))),            \
+     (da)->DA_ITEMS_FIELD + (da)->DA_COUNT_FIELD)
+
+#define da_commit(da, n) ((da)->DA_COUNT_FIELD += (n))
+
+#define da_insert(ctx, da, i, item) da__insert(DA__HEAP, ctx, da, i, item)
+
+#define da__insert(S, ctx, da, i, item)                                       \
+    do {                                                                      \
+        size_t da__i = (i);                                                   \
+        da__grow(S, ctx, da, (size_t)(da)->DA_COUNT_FIELD + 1);               \
+        DA_MEMMOVE((da)->DA_ITEMS_FIELD + da__i + 1,                          \
+                   (da)->DA_ITEMS_FIELD + da__i,                              \
+                   sizeof(*(da)->DA_ITEMS_FIELD) *                            \
+                   ((da)->DA_COUNT_FIELD - da__i));                           \
+        (da)->DA_ITEMS_FIELD[da__i] = (item);                                 \
+        (da)->DA_COUNT_FIELD++;                                               \
+    } while (0)
+
+#define da_insert_many(ctx, da, i, items, count)                              \
+    da__splice(DA__HEAP, ctx, da, i, 0, items, count)
+
+#define da_splice(ctx, da, i, n, items, count)                                \
+    da__splice(DA__HEAP, ctx, da, i, n, items, count)
+
+#define da__splice(S, ctx, da, i, n, items, count)                            \
+    do {                                                                      \
+        size_t da__i = (i), da__n = (n), da__count = (count);                 \
+        DA__CHECK_SAME_TYPE((items), (da)->DA_ITEMS_FIELD);                   \
+        if (da__count > da__n)                                                \
+            da__grow(S, ctx, da, da__add_sat((da)->DA_COUNT_FIELD,            \
+                                             da__count - da__n));             \
+        if (da__count != da__n)                                               \
+            DA_MEMMOVE((da)->DA_ITEMS_FIELD + da__i + da__count,              \
+                       (da)->DA_ITEMS_FIELD + da__i + da__n,                  \
+                       sizeof(*(da)->DA_ITEMS_FIELD) *                        \
+                       ((da)->DA_COUNT_FIELD - da__i - da__n));               \
+        if (da__count > 0)                                                    \
+            DA_MEMCPY((da)->DA_ITEMS_FIELD + da__i,                           \
+                      (items),                                                \
+                      sizeof(*(da)->DA_ITEMS_FIELD) * da__count);             \
+        (da)->DA_COUNT_FIELD += da__count - da__n;                            \
+    } while (0)
+
+#define da_reserve(ctx, da, n) da__reserve(DA__HEAP, ctx, da, n)
+
+#define da__reserve(S, ctx, da, n)                                            \
+    da__grow(S, ctx, da, da__add_sat((da)->DA_COUNT_FIELD, (n)))
+
+#define da_reserve_exact(ctx, da, n) da__reserve_exact(DA__HEAP, ctx, da, n)
+
+#define da__reserve_exact(S, ctx, da, n)                                      \
+    (da__add_sat((da)->DA_COUNT_FIELD, (n)) > (da)->DA_CAPACITY_FIELD ?       \
+     (DA__UNLIKELY(!da__checked_capacity(                                     \
+          S, da, da__add_sat((da)->DA_COUNT_FIELD, (n)))) ?                   \
+      da__capacity_failure(da) :                                              \
+      da__set_capacity(S, ctx, da,                                            \
+                       DA__MIN(da__add_sat((da)->DA_COUNT_FIELD, (n)),        \
+                               DA__MAX_CAPACITY(S, da)))) : 0)
+
+#define da_shrink_to_fit(ctx, da) da__shrink_to_fit(DA__HEAP, ctx, da)
+
+#define da__shrink_to_fit(S, ctx, da)                                         \
+    ((da)->DA_COUNT_FIELD < (da)->DA_CAPACITY_FIELD ?                         \
+     ((da)->DA_COUNT_FIELD > 0 ?                                              \
+      da__set_capacity(S, ctx, da, (da)->DA_COUNT_FIELD) :                    \
+      (da__free(S, ctx, da),                                                  \
+       (da)->DA_ITEMS_FIELD = 0,                                              \
+       (da)->DA_CAPACITY_FIELD = 0)) : 0)
+
 /* convert an lvalue to an rvalue (for private use) */
 #if defined(__cplusplus) && defined(__cpp_auto_cast)
 # define DA__RVALUE(V) auto(V)
@@ -277,16 +1207,376 @@ typedef size_t da_size;
 
 #define da_pop_or(da, expr) ((da)->DA_COUNT_FIELD > 0 ? da_pop(da) : (expr))
 
-#define da_memdup(ctx, da)                                                    \
+/* read and write a count field of any width (for private use) */
+static inline size_t
+da__get_count(const void *count, size_t size)
+{
+    switch (size) {
+    case 1: { uint8_t n;  DA_MEMCPY(&n, count, 1); return n; }
+    case 2: { uint16_t n; DA_MEMCPY(&n, count, 2); return n; }
+    case 4: { uint32_t n; DA_MEMCPY(&n, count, 4); return n; }
+    default: { uint64_t n; DA_MEMCPY(&n, count, 8); return (size_t)n; }
+    }
+}
+
+static inline void
+da__set_count(void *count, size_t size, size_t value)
+{
+    switch (size) {
+    case 1: { uint8_t n = (uint8_t)value;   DA_MEMCPY(count, &n, 1); break; }
+    case 2: { uint16_t n = (uint16_t)value; DA_MEMCPY(count, &n, 2); break; }
+    case 4: { uint32_t n = (uint32_t)value; DA_MEMCPY(count, &n, 4); break; }
+    default: { uint64_t n = value;          DA_MEMCPY(count, &n, 8); break; }
+    }
+}
+
+/* move up to `n' items of `size' bytes from the end of `items' to `out'
+   and return how many were moved (for private use) */
+static inline size_t
+da__pop_many(const void *items, size_t size, void *count, size_t count_size,
+             void *out, size_t n)
+{
+    size_t have = da__get_count(count, count_size);
+
+    if (n > have)
+        n = have;
+    if (n > 0) {
+        DA_MEMCPY(out, (const char *)items + (have - n) * size, n * size);
+        da__set_count(count, count_size, have - n);
+    }
+    return n;
+}
+
+#define da_pop_many(da, out, n)                                               \
+    (DA__CHECK_SAME_TYPE((out), (da)->DA_ITEMS_FIELD),                        \
+     da__pop_many((da)->DA_ITEMS_FIELD,                                       \
+                  sizeof(*(da)->DA_ITEMS_FIELD),                              \
+                  &(da)->DA_COUNT_FIELD,                                      \
+                  sizeof((da)->DA_COUNT_FIELD),                               \
+                  (out),                                                      \
+                  (n)))
+
+#define da_drain(da, out) da_pop_many(da, out, (da)->DA_COUNT_FIELD)
+
+#define da_remove(da, i) da_remove_range(da, i, 1)
+
+#define da_remove_range(da, i, n)                                             \
+    (DA_MEMMOVE((da)->DA_ITEMS_FIELD + (i),                                   \
+                (da)->DA_ITEMS_FIELD + (i) + (n),                             \
+                sizeof(*(da)->DA_ITEMS_FIELD) *                               \
+                ((size_t)(da)->DA_COUNT_FIELD - (i) - (n))),                  \
+     (void)((da)->DA_COUNT_FIELD -= (n)))
+
+#define da_swap_remove(da, i)                                                 \
+    ((da)->DA_ITEMS_FIELD[(i)] =                                              \
+         (da)->DA_ITEMS_FIELD[(da)->DA_COUNT_FIELD - 1],                      \
+     (void)--(da)->DA_COUNT_FIELD)
+
+#define da_memdup(ctx, da) da__memdup(DA__HEAP, ctx, da)
+
+#define da__memdup(S, ctx, da)                                                \
     DA__CAST((da)->DA_ITEMS_FIELD)DA_MEMCPY(                                  \
-        DA_MALLOC((ctx), sizeof(*(da)->DA_ITEMS_FIELD)*(da)->DA_COUNT_FIELD), \
+        da__malloc_items(S, ctx, da, (da)->DA_COUNT_FIELD),                   \
         (da)->DA_ITEMS_FIELD,                                                 \
         sizeof(*(da)->DA_ITEMS_FIELD)*(da)->DA_COUNT_FIELD)
 
-#define da_free(ctx, da)                                                      \
-    DA_FREE((ctx),                                                            \
-            (da)->DA_ITEMS_FIELD,                                             \
-            (da)->DA_CAPACITY_FIELD * sizeof(*(da)->DA_ITEMS_FIELD))
+#define da_memdup_free(ctx, da, ptr, count)                                   \
+    da__memdup_free(DA__HEAP, ctx, da, ptr, count)
+
+#define da__memdup_free(S, ctx, da, ptr, count)                               \
+    ((void)sizeof((ptr) == (da)->DA_ITEMS_FIELD),                             \
+     (void)da__free_items(S, ctx, da, ptr, count))
+
+/* read `*pp' and set it to a null pointer (for private use) */
+static inline void *
+da__take_ptr(void *pp)
+{
+    void *p, *null = 0;
+
+    DA_MEMCPY(&p, pp, sizeof(p));
+    DA_MEMCPY(pp, &null, sizeof(null));
+    return p;
+}
+
+#define da_take(da)                                                           \
+    ((da)->DA_COUNT_FIELD = 0,                                                \
+     (da)->DA_CAPACITY_FIELD = 0,                                             \
+     DA__CAST((da)->DA_ITEMS_FIELD)da__take_ptr(&(da)->DA_ITEMS_FIELD))
+
+#define da_free(ctx, da) da__free(DA__HEAP, ctx, da)
+
+#define da__free(S, ctx, da)                                                  \
+    (da__is_inline(S, da) ? (void)0 :                                         \
+     (void)da__free_items(S, ctx, da,                                         \
+                          (da)->DA_ITEMS_FIELD,                               \
+                          (da)->DA_CAPACITY_FIELD))
+
+/* DynamicArraySmall(T, N) counterparts of the da_* macros that resize or
+   free a dynamic array */
+#define da_small_append(ctx, da, item) da__append(DA__SMALL, ctx, da, item)
+
+#define da_small_append_many(ctx, da, items, count)                           \
+    da__append_many(DA__SMALL, ctx, da, items, count)
+
+#define da_small_try_append(ctx, da, item)                                    \
+    da__try_append(DA__SMALL, ctx, da, item)
+
+#define da_small_try_append_many(ctx, da, items, count)                       \
+    da__try_append_many(DA__SMALL, ctx, da, items, count)
+
+#define da_small_try_reserve(ctx, da, n) da__try_reserve(DA__SMALL, ctx, da, n)
+
+#define da_small_append_uninit(ctx, da, n)                                    \
+    da__append_uninit(DA__SMALL, ctx, da, n)
+
+#define da_small_insert(ctx, da, i, item)                                     \
+    da__insert(DA__SMALL, ctx, da, i, item)
+
+#define da_small_insert_many(ctx, da, i, items, count)                        \
+    da__splice(DA__SMALL, ctx, da, i, 0, items, count)
+
+#define da_small_splice(ctx, da, i, n, items, count)                          \
+    da__splice(DA__SMALL, ctx, da, i, n, items, count)
+
+#define da_small_reserve(ctx, da, n) da__reserve(DA__SMALL, ctx, da, n)
+
+#define da_small_reserve_exact(ctx, da, n)                                    \
+    da__reserve_exact(DA__SMALL, ctx, da, n)
+
+#define da_small_shrink_to_fit(ctx, da) da__shrink_to_fit(DA__SMALL, ctx, da)
+
+#define da_small_free(ctx, da) da__free(DA__SMALL, ctx, da)
+
+/* DynamicArrayAligned(T, A) counterparts of the da_* macros that allocate
+   or free the items */
+#define da_aligned_append(ctx, da, item) da__append(DA__ALIGNED, ctx, da, item)
+
+#define da_aligned_append_many(ctx, da, items, count)                         \
+    da__append_many(DA__ALIGNED, ctx, da, items, count)
+
+#define da_aligned_try_append(ctx, da, item)                                  \
+    da__try_append(DA__ALIGNED, ctx, da, item)
+
+#define da_aligned_try_append_many(ctx, da, items, count)                     \
+    da__try_append_many(DA__ALIGNED, ctx, da, items, count)
+
+#define da_aligned_try_reserve(ctx, da, n)                                    \
+    da__try_reserve(DA__ALIGNED, ctx, da, n)
+
+#define da_aligned_append_uninit(ctx, da, n)                                  \
+    da__append_uninit(DA__ALIGNED, ctx, da, n)
+
+#define da_aligned_insert(ctx, da, i, item)                                   \
+    da__insert(DA__ALIGNED, ctx, da, i, item)
+
+#define da_aligned_insert_many(ctx, da, i, items, count)                      \
+    da__splice(DA__ALIGNED, ctx, da, i, 0, items, count)
+
+#define da_aligned_splice(ctx, da, i, n, items, count)                        \
+    da__splice(DA__ALIGNED, ctx, da, i, n, items, count)
+
+#define da_aligned_reserve(ctx, da, n) da__reserve(DA__ALIGNED, ctx, da, n)
+
+#define da_aligned_reserve_exact(ctx, da, n)                                  \
+    da__reserve_exact(DA__ALIGNED, ctx, da, n)
+
+#define da_aligned_shrink_to_fit(ctx, da)                                     \
+    da__shrink_to_fit(DA__ALIGNED, ctx, da)
+
+#define da_aligned_memdup(ctx, da) da__memdup(DA__ALIGNED, ctx, da)
+
+#define da_aligned_memdup_free(ctx, da, ptr, count)                           \
+    da__memdup_free(DA__ALIGNED, ctx, da, ptr, count)
+
+#define da_aligned_free(ctx, da) da__free(DA__ALIGNED, ctx, da)
+
+/* the ctx parameter, argument and da_* macro argument of the functions
+   defined by DA_DEFINE_CTX() and DA_DEFINE() (for private use) */
+#define DA__CTX_PARAM(CtxT) CtxT ctx,
+#define DA__CTX_ARG(ctx)    ctx,
+#define DA__CTX(ctx)        ctx
+#define DA__NO_CTX_PARAM(CtxT)
+#define DA__NO_CTX_ARG(ctx)
+#define DA__NO_CTX(ctx)
+
+#define DA_DEFINE(name, T)                                                    \
+    DA__DEFINE(name, T, void, DA__NO_CTX_PARAM, DA__NO_CTX_ARG, DA__NO_CTX)
+
+#define DA_DEFINE_CTX(name, T, CtxT)                                          \
+    DA__DEFINE(name, T, CtxT, DA__CTX_PARAM, DA__CTX_ARG, DA__CTX)
+
+#define DA__DEFINE(name, T, CtxT, PARAM, ARG, CTX)                            \
+    typedef DynamicArray(T) name;                                             \
+                                                                              \
+    static DA__COLD void                                                      \
+    name##__grow(PARAM(CtxT) name *da, size_t needed)                         \
+    {                                                                         \
+        da__grow(DA__HEAP, CTX(ctx), da, needed);                             \
+    }                                                                         \
+                                                                              \
+    static inline T *                                                         \
+    name##_append(PARAM(CtxT) name *da, T item)                               \
+    {                                                                         \
+        if (DA__UNLIKELY(da->DA_COUNT_FIELD >= da->DA_CAPACITY_FIELD))        \
+            name##__grow(ARG(ctx) da, (size_t)da->DA_COUNT_FIELD + 1);        \
+        da->DA_ITEMS_FIELD[da->DA_COUNT_FIELD] = item;                        \
+        return &da->DA_ITEMS_FIELD[da->DA_COUNT_FIELD++];                     \
+    }                                                                         \
+                                                                              \
+    static inline void                                                        \
+    name##_append_many(PARAM(CtxT) name *da, T const *items, size_t count)    \
+    {                                                                         \
+        if (DA__UNLIKELY(count > (size_t)(da->DA_CAPACITY_FIELD -             \
+                                          da->DA_COUNT_FIELD)))               \
+            name##__grow(ARG(ctx) da,                                         \
+                         da__add_sat(da->DA_COUNT_FIELD, count));             \
+        if (count > 0)                                                        \
+            DA_MEMCPY(da->DA_ITEMS_FIELD + da->DA_COUNT_FIELD,                \
+                      items,                                                  \
+                      sizeof(T) * count);                                     \
+        da->DA_COUNT_FIELD += count;                                          \
+    }                                                                         \
+                                                                              \
+    static inline void                                                        \
+    name##_reserve(PARAM(CtxT) name *da, size_t n)                            \
+    {                                                                         \
+        if (DA__UNLIKELY(n > (size_t)(da->DA_CAPACITY_FIELD -                 \
+                                      da->DA_COUNT_FIELD)))                   \
+            name##__grow(ARG(ctx) da, da__add_sat(da->DA_COUNT_FIELD, n));    \
+    }                                                                         \
+                                                                              \
+    static inline T                                                           \
+    name##_pop(name *da)                                                      \
+    {                                                                         \
+        return da->DA_ITEMS_FIELD[--da->DA_COUNT_FIELD];                      \
+    }                                                                         \
+                                                                              \
+    static inline void                                                        \
+    name##_free(PARAM(CtxT) name *da)                                         \
+    {                                                                         \
+        da_free(CTX(ctx), da);                                                \
+    }                                                                         \
+                                                                              \
+    typedef int name##__define_requires_a_semicolon
+
+/* header of a StretchyBuffer(T), padded to keep the items aligned */
+typedef union {
+    struct { da_size DA_COUNT_FIELD, DA_CAPACITY_FIELD; } h;
+    long double da__align_ld;
+    long long da__align_ll;
+    void *da__align_p;
+} da__sbuf_header;
+
+#define StretchyBuffer(T) T *
+
+#define sbuf__hdr(b) ((da__sbuf_header *)(void *)(b) - 1)
+
+#define sbuf__items(b, hdr)                                                   \
+    DA__CAST((b) + 0)(void *)((da__sbuf_header *)(hdr) + 1)
+
+#define sbuf__size(b, cap)                                                    \
+    (sizeof(da__sbuf_header) + (size_t)(cap) * sizeof(*(b)))
+
+/* largest capacity of a stretchy buffer (for private use) */
+#define SBUF__MAX_CAPACITY(b)                                                 \
+    DA__MIN(DA__SIZE_MAX(((da__sbuf_header *)0)->h.DA_CAPACITY_FIELD),        \
+            (DA__MAX_SIZE - sizeof(da__sbuf_header)) / sizeof(*(b)))
+
+/* capacity a stretchy buffer of capacity `cap' grows to in order to fit
+   `needed' items, at most SBUF__MAX_CAPACITY(b) items (for private use) */
+#define sbuf__next_capacity(b, cap, needed)                                   \
+    DA__MIN(DA_GROWTH((cap), (needed), sizeof(*(b))), SBUF__MAX_CAPACITY(b))
+
+#define sbuf__count(b) (sbuf__hdr(b)->h.DA_COUNT_FIELD)
+
+#define sbuf__capacity(b) (sbuf__hdr(b)->h.DA_CAPACITY_FIELD)
+
+#define sbuf_count(b) ((b) ? sbuf__count(b) : 0)
+
+#define sbuf_capacity(b) ((b) ? sbuf__capacity(b) : 0)
+
+#ifdef DA_USABLE_SIZE
+# define sbuf__usable_capacity(ctx, b, cap)                                   \
+    DA__MIN((DA_USABLE_SIZE((ctx), sbuf__hdr(b), sbuf__size(b, cap)) -        \
+             sizeof(da__sbuf_header)) / sizeof(*(b)),                         \
+            SBUF__MAX_CAPACITY(b))
+#else
+# define sbuf__usable_capacity(ctx, b, cap) (cap)
+#endif
+
+#ifdef DA_TRY_EXPAND
+# define sbuf__try_expand(ctx, b, cap)                                        \
+    (DA_TRY_EXPAND((ctx),                                                     \
+                   sbuf__hdr(b),                                              \
+                   sbuf__size(b, sbuf__capacity(b)),                          \
+                   sbuf__size(b, cap)) ?                                      \
+     (DA__STAT(expand_hits), 1) : (DA__STAT(expand_misses), 0))
+#else
+# define sbuf__try_expand(ctx, b, cap) 0
+#endif
+
+/* grow the stretchy buffer according to DA_GROWTH so that it fits at least
+   `needed' items, when it can't fit them it fails through
+   da__capacity_overflow() (for private use) */
+#define sbuf__grow(ctx, b, needed)                                            \
+    (DA__UNLIKELY(!(b) || (needed) > sbuf__capacity(b)) ?                     \
+     (DA__UNLIKELY((size_t)(needed) > SBUF__MAX_CAPACITY(b)) ?                \
+      ((b) = DA__CAST((b) + 0)da__capacity_overflow(), 0) :                   \
+      !(b) ?                                                                  \
+      ((b) = sbuf__items(b, DA_MALLOC(                                        \
+           (ctx),                                                             \
+           sbuf__size(b, sbuf__next_capacity(b, 0, needed)))),                \
+       sbuf__count(b) = 0,                                                    \
+       sbuf__capacity(b) = sbuf__usable_capacity(                             \
+           ctx, b, sbuf__next_capacity(b, 0, needed))) :                      \
+      ((void)(sbuf__try_expand(ctx, b, sbuf__next_capacity(b,                 \
+                                                           sbuf__capacity(b), \
+                                                           needed)) ||        \
+              (DA__STAT(reallocs),                                            \
+               (b) = sbuf__items(b, DA_REALLOC(                               \
+                   (ctx),                                                     \
+                   sbuf__hdr(b),                                              \
+                   sbuf__size(b, sbuf__capacity(b)),                          \
+                   sbuf__size(b, sbuf__next_capacity(b,                       \
+                                                     sbuf__capacity(b),       \
+                                                     needed)))))),            \
+       sbuf__capacity(b) = sbuf__usable_capacity(                             \
+           ctx, b, sbuf__next_capacity(b, sbuf__capacity(b), needed)))) : 0)
+
+#define sbuf_append(ctx, b, item)                                             \
+    (sbuf__grow(ctx, b, sbuf_count(b) + 1),                                   \
+     (b)[sbuf__count(b)++] = (item))
+
+#define sbuf_append_many(ctx, b, items, count)                                \
+    do {                                                                      \
+        size_t da__count = (count);                                           \
+        DA__CHECK_SAME_TYPE((items), (b));                                    \
+        if (da__count > 0) {                                                  \
+            sbuf__grow(ctx, b, da__add_sat(sbuf_count(b), da__count));        \
+            DA_MEMCPY((b) + sbuf__count(b),                                   \
+                      (items),                                                \
+                      sizeof(*(b)) * da__count);                              \
+            sbuf__count(b) += da__count;                                      \
+        }                                                                     \
+    } while (0)
+
+#define sbuf_reserve(ctx, b, n)                                               \
+    sbuf__grow(ctx, b, da__add_sat(sbuf_count(b), (n)))
+
+#define sbuf_pop(b) DA__RVALUE((b)[--sbuf__count(b)])
+
+#define sbuf_pop_or(b, expr) (sbuf_count(b) > 0 ? sbuf_pop(b) : (expr))
+
+#define sbuf_memdup(ctx, b)                                                   \
+    DA__CAST((b) + 0)DA_MEMCPY(                                               \
+        DA_MALLOC((ctx), sizeof(*(b)) * sbuf_count(b)),                       \
+        (b),                                                                  \
+        sizeof(*(b)) * sbuf_count(b))
+
+#define sbuf_free(ctx, b)                                                     \
+    ((b) ? (void)DA_FREE((ctx),                                               \
+                         sbuf__hdr(b),                                        \
+                         sbuf__size(b, sbuf__capacity(b))) : (void)0)
 
 #ifndef DA_NO_STRING_BUILDER
 
@@ -296,14 +1586,32 @@ typedef DynamicArray(char) DA_STRING_BUILDER_T;
 typedef DynamicArray(char) StringBuilder;
 #endif
 
-#define SB_INIT        DA_INIT
-#define sb_from_parts  da_from_parts
-#define sb_append      da_append
-#define sb_append_many da_append_many
-#define sb_pop         da_pop
-#define sb_pop_or      da_pop_or
-#define sb_memdup      da_memdup
-#define sb_free        da_free
+#define SB_INIT            DA_INIT
+#define sb_from_parts      da_from_parts
+#define sb_append          da_append
+#define sb_append_many     da_append_many
+#define sb_try_append      da_try_append
+#define sb_try_append_many da_try_append_many
+#define sb_try_reserve     da_try_reserve
+#define sb_append_uninit   da_append_uninit
+#define sb_commit          da_commit
+#define sb_insert          da_insert
+#define sb_insert_many     da_insert_many
+#define sb_splice          da_splice
+#define sb_reserve         da_reserve
+#define sb_reserve_exact   da_reserve_exact
+#define sb_shrink_to_fit   da_shrink_to_fit
+#define sb_pop             da_pop
+#define sb_pop_or          da_pop_or
+#define sb_pop_many        da_pop_many
+#define sb_drain           da_drain
+#define sb_remove          da_remove
+#define sb_remove_range    da_remove_range
+#define sb_swap_remove     da_swap_remove
+#define sb_memdup          da_memdup
+#define sb_memdup_free     da_memdup_free
+#define sb_take            da_take
+#define sb_free            da_free
 
 #define sb_with_capacity(ctx, cap)   da_with_capacity(char, ctx, cap)
 #define sb_append_null(ctx, sb)      da_append(ctx, sb, '\0')
@@ -318,6 +1626,13 @@ typedef DynamicArray(char) StringBuilder;
         + (sb)->DA_COUNT_FIELD, '\0', 1)                                      \
      - (sb)->DA_COUNT_FIELD)
 
+#define sb_into_cstr(ctx, sb)                                                 \
+    ((sb)->DA_CAPACITY_FIELD != (size_t)(sb)->DA_COUNT_FIELD + 1 ?            \
+     da__set_capacity(DA__HEAP, ctx, sb,                                      \
+                      (size_t)(sb)->DA_COUNT_FIELD + 1) : 0,                  \
+     (sb)->DA_ITEMS_FIELD[(sb)->DA_COUNT_FIELD] = '\0',                       \
+     da_take(sb))
+
 #endif // DA_NO_STRING_BUILDER
 #endif // DYNAMIC_ARRAY_H
 